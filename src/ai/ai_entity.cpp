@@ -22,11 +22,14 @@
 #include "game.h"
 #include "map_renderer.h"
 #include "sb_map.h"
+#include "pathfinder.h"
 #include <particle/particle.h>
 
 ai_entity::ai_entity(const float3& position) :
-physics_entity(position, float2(0.5f, 0.5f), "spheroid.a2m", "ai.a2mtl"),
-waypoints(active_map->get_ai_waypoints())
+physics_entity(position, float2(0.5f, 0.5f), "spheroid.a2m", "ai.a2mtl", true),
+waypoints(active_map->get_ai_waypoints()),
+pf(active_map->get_pathfinder()),
+rng((minstd_rand::result_type)core::rand(1, numeric_limits<int>::max()))
 {
 	speed = 2.0f;
 	default_speed = speed;
@@ -47,42 +50,100 @@ waypoints(active_map->get_ai_waypoints())
 	}
 	if(min_wp.second != nullptr) {
 		cur_waypoint = min_wp.second;
-		move_to_position(cur_waypoint->position);
+		request_waypoint_path();
 		target_mode = AI_TARGET_MODE::WAYPOINT;
 	}
-	
-	//
-	if(pm != nullptr) {
-		auto tex = mr->get_particle_texture("AI_ATTACK");
-		if(tex != nullptr) {
-			attack_ps = pm->add_particle_system(particle_system::EMITTER_TYPE::SPHERE,
-												particle_system::LIGHTING_TYPE::NONE,
-												tex,
-												8192,
-												500,
-												5.0f,
-												float3(0.0f),
-												float3(0.0f),
-												float3(0.1f),
-												float3(0.0f, 1.0, 0.0f),
-												float3(0.0f),
-												float3(0.0f, 0.0f, 0.0f),
-												float4(0.85f, 0.05f, 0.05f, 0.125f),
-												float2(0.075f, 0.075f));
-			attack_ps->set_active(false);
-			attack_ps->set_visible(false);
-		}
-	}
 }
 
 ai_entity::~ai_entity() {
+	eevt->add_event(EVENT_TYPE::AI_DESTROY, make_shared<ai_destroy_event>(SDL_GetTicks(), this));
+	pf->cancel_path(this);
+	
 	if(attack_ps != nullptr) {
-		pm->delete_particle_system(attack_ps);
+		mr->release_attack_effect(attack_ps);
 		attack_ps = nullptr;
 	}
 }
 
+void ai_entity::think(const physics_snapshot& snapshot) {
+	// note: this is only called when the ai is due (see ai_store::schedule)
+	player_position = snapshot.player_position;
+	
+	// still being pushed -> handled in physics_update
+	if(!target_position.is_null() && (target_position - get_position()).length() > 2.0f) {
+		return;
+	}
+	
+	target_position.set(0.0f, 0.0f, 0.0f);
+	
+	if (target_mode != AI_TARGET_MODE::WAIT) {
+		sense();
+	}
+	
+	switch(target_mode) {
+		// patrol mode
+		case AI_TARGET_MODE::PATROL:
+			// nobody will notice far away ais patrolling
+			if(lod == AI_LOD::MINIMAL) stop_moving();
+			else do_patrolling();
+			break;
+	
+		// follow mode
+		case AI_TARGET_MODE::FOLLOW: {
+			// follow the flow field towards the player if possible, otherwise move straight at the player
+			uint3 next_block;
+			if(pf->get_flow_step(get_block_position(), next_block)) {
+				move_to_block(next_block);
+			}
+			else move_to_position(player_position);
+		}
+		break;
+			
+		// tractor mode
+		case AI_TARGET_MODE::ATTACK:
+			attack_pending = true;
+			break;
+	
+		case AI_TARGET_MODE::WAIT:
+			stop_moving();
+			wait(5.0f);
+			break;
+
+		case AI_TARGET_MODE::NONE:
+			reset_parameters();
+			break;
+			
+		case AI_TARGET_MODE::WAYPOINT:
+			check_waypoint();
+			follow_path();
+			break;
+	}
+}
+
+bool ai_entity::is_idle() const {
+	return (move_direction.is_null() && target_position.is_null());
+}
+
+AI_LOD ai_entity::get_lod() const {
+	return lod;
+}
+
+void ai_entity::set_lod(const AI_LOD& lod_) {
+	lod = lod_;
+}
+
 void ai_entity::physics_update() {
+	// far away and idle -> let the body sleep (it will be woken up by collisions, block changes or a lod change)
+	if(lod == AI_LOD::MINIMAL && is_idle()) {
+		if(body->isActive() && body->getLinearVelocity().length2() < 0.01f) {
+			body->forceActivationState(ISLAND_SLEEPING);
+		}
+		if(!body->isActive()) return;
+	}
+	else if(!body->isActive()) {
+		body->activate(true);
+	}
+	
 	float3 target_dir = target_position - get_position();
 	const float len = target_dir.length();
 	if (!target_position.is_null() && (len > 2.0f)) {
@@ -90,59 +151,35 @@ void ai_entity::physics_update() {
 		target_dir = target_dir.normalized() * std::max<float>(len, 0.5f);
 		character_body->get_body()->setLinearVelocity(btVector3(target_dir[0], 0.0f, target_dir[2]));
 	}
-	else {
-		target_position.set(0.0f, 0.0f, 0.0f);
-		
-		if (target_mode != AI_TARGET_MODE::WAIT) {
-			sense();
-		}
-		
-		switch(target_mode) {
-			// patrol mode
-			case AI_TARGET_MODE::PATROL:
-				do_patrolling();
-				break;
-		
-			// follow mode
-			case AI_TARGET_MODE::FOLLOW:
-				move_to_position(ge->get_position());
-				break;
-				
-			// tractor mode
-			case AI_TARGET_MODE::ATTACK:
-				force_push_player();
-				break;
-		
-			case AI_TARGET_MODE::WAIT:
-				stop_moving();
-				wait(5.0f);
-				break;
-
-			case AI_TARGET_MODE::NONE:
-				reset_parameters();
-				break;
-				
-			case AI_TARGET_MODE::WAYPOINT:
-				check_waypoint();
-				break;
-		}
+	else if(attack_pending) {
+		attack_pending = false;
+		force_push_player();
 	}
 	
 	physics_entity::physics_update();
 }
 
 void ai_entity::graphics_update() {
-	// set/compute ai rotation (averaged over multiple frames)
+	// set/compute ai rotation (averaged over multiple frames, but only in full lod)
 	const float2 norm_dir(float2(move_direction.x, move_direction.z).normalized());
 	if(!norm_dir.is_null() && !norm_dir.is_nan()) {
-		avg_rotation[avg_rotation_index] = norm_dir;
-		avg_rotation_index = (avg_rotation_index + 1) % avg_rotation.size();
-		
-		float2 avg_rot(0.0f, 0.0f);
-		for(const auto& rot : avg_rotation) {
-			avg_rot += rot;
+		float2 avg_rot(norm_dir);
+		if(lod == AI_LOD::FULL) {
+			// history is outdated after a lod change -> start over
+			if(!avg_rotation_valid) {
+				avg_rotation.fill(norm_dir);
+				avg_rotation_valid = true;
+			}
+			avg_rotation[avg_rotation_index] = norm_dir;
+			avg_rotation_index = (avg_rotation_index + 1) % avg_rotation.size();
+			
+			avg_rot = float2(0.0f, 0.0f);
+			for(const auto& rot : avg_rotation) {
+				avg_rot += rot;
+			}
+			avg_rot.normalize();
 		}
-		avg_rot.normalize();
+		else avg_rotation_valid = false;
 		
 		const float cur_rot = core::wrap(fabs(RAD2DEG(acosf(avg_rot.dot(float2(0.0f, -1.0f))))
 											  + (avg_rot.x < 0.0f ? -360.0f : 0.0f)
@@ -151,13 +188,28 @@ void ai_entity::graphics_update() {
 		set_rotation(float3(0.0f, cur_rot, 0.0f));
 	}
 	
-	// handle attack particle system deactivtion
+	// start a queued attack particle system (borrowed from the shared pool, there might be none left)
+	const unsigned int attack_start = attack_start_ticks.exchange(0);
+	if(attack_start != 0) {
+		if(attack_ps == nullptr) {
+			attack_ps = mr->acquire_attack_effect();
+		}
+		if(attack_ps != nullptr) {
+			attack_ps->set_position(get_position());
+			attack_ps->set_direction((ge->get_position() - get_position() + float3(0.0f, 0.5f, 0.0f)).normalized());
+			attack_ps->set_active(true);
+			attack_ps->set_visible(true);
+			attack_ps_timer = attack_start;
+		}
+	}
+	
+	// return the attack particle system to the pool once the attack is over
 	static constexpr unsigned int attack_ps_duration = 400;
 	if(attack_ps != nullptr && attack_ps_timer > 0 &&
 	   (SDL_GetTicks() - attack_ps_timer) > attack_ps_duration) {
 		attack_ps_timer = 0;
-		attack_ps->set_active(false);
-		attack_ps->set_visible(false);
+		mr->release_attack_effect(attack_ps);
+		attack_ps = nullptr;
 	}
 	
 	physics_entity::graphics_update();
@@ -176,7 +228,7 @@ void ai_entity::turn_back() {
 }
 
 float ai_entity::get_distance_to_player() {
-	return (ge->get_position() - get_position()).length();
+	return (player_position - get_position()).length();
 }
 
 void ai_entity::sense() {
@@ -224,8 +276,9 @@ void ai_entity::do_patrolling() {
 	
 	
 	// possibility which direction to choose
-	const float p = core::rand(0.0f, 1.0f);
-	const unsigned int r = core::rand(0, 7);
+	uniform_real_distribution<float> chance_dist(0.0f, 1.0f);
+	const float p = chance_dist(rng);
+	const unsigned int r = uniform_int_distribution<unsigned int>(0, 6)(rng);
 	
 	// check if object will change direction
 	if (p < move_array_p[r]) {
@@ -233,7 +286,7 @@ void ai_entity::do_patrolling() {
 	}
 	
 	// turn back with a certain possibility
-	if(core::rand(0.0f, 1.0f) < chance) {
+	if(chance_dist(rng) < chance) {
 		turn_back();
 	}
 }
@@ -264,14 +317,8 @@ void ai_entity::force_push_player() {
 	
 	target_mode = AI_TARGET_MODE::WAIT;
 	
-	// start attack particle system
-	if(attack_ps != nullptr) {
-		attack_ps_timer = SDL_GetTicks();
-		attack_ps->set_position(mdl->get_position());
-		attack_ps->set_active(true);
-		attack_ps->set_visible(true);
-		attack_ps->set_direction((ge->get_position() - get_position() + float3(0.0f, 0.5f, 0.0f)).normalized());
-	}
+	// the attack particle system is started by the next graphics_update (render thread)
+	attack_start_ticks = std::max(SDL_GetTicks(), 1u);
 }
 
 void ai_entity::wait(const unsigned int& seconds) {
@@ -300,14 +347,60 @@ void ai_entity::next_waypoint() {
 	
 	cur_waypoint = cur_waypoint->next;
 	if(cur_waypoint != nullptr) {
-		move_to_position(cur_waypoint->position);
+		request_waypoint_path();
 	}
 	else {
 		// -> free movement again
+		path.clear();
+		pf->cancel_path(this);
 		sense();
 	}
 }
 
+void ai_entity::request_waypoint_path() {
+	if(cur_waypoint == nullptr) return;
+	
+	// move straight towards the waypoint until the path has been computed
+	path.clear();
+	path_index = 0;
+	pf->request_path(this, get_block_position(), cur_waypoint->position);
+	move_to_position(cur_waypoint->position);
+}
+
+void ai_entity::follow_path() {
+	if(cur_waypoint == nullptr) return;
+	
+	// pick up new or repaired paths
+	if(pf->get_path(this, path)) {
+		path_index = 0;
+	}
+	
+	// skip all path nodes that have already been reached (xz distance to the block center)
+	const float3 pos(get_position());
+	while(path_index < path.size() &&
+		  float2(float(path[path_index].x) + 0.5f - pos.x,
+				 float(path[path_index].z) + 0.5f - pos.z).length() < 0.3f) {
+		path_index++;
+	}
+	
+	if(path_index < path.size()) {
+		move_to_block(path[path_index]);
+	}
+	else {
+		// no path (yet) or end of path -> straight line
+		move_to_position(cur_waypoint->position);
+	}
+}
+
+void ai_entity::move_to_block(const uint3& block) {
+	// only move upwards when the block is above the current one
+	float3 block_center(float3(block) + 0.5f);
+	if(block.y <= get_block_position().y) {
+		block_center.y = get_position().y;
+	}
+	move_to_position(block_center);
+}
+
 void ai_entity::move_to_position(const float3& pos) {
 	move_position = pos;
 	calc_move_direction(get_position(), move_position);
@@ -23,6 +23,9 @@
 #include "sb_global.h"
 #include "physics_entity.h"
 #include "sb_map.h"
+#include "ai_store.h"
+#include <random>
+#include <atomic>
 
 enum class AI_TARGET_MODE : unsigned int {
 	NONE,
@@ -34,11 +37,13 @@ enum class AI_TARGET_MODE : unsigned int {
 };
 
 class particle_system;
+class pathfinder;
 class ai_entity : public physics_entity {
 public:
 	ai_entity(const float3& position);
 	virtual ~ai_entity();
 	
+	virtual void think(const physics_snapshot& snapshot);
 	virtual void physics_update();
 	virtual void graphics_update();
 	
@@ -65,6 +70,10 @@ public:
 
 	virtual void reset_parameters();
 	virtual void wait(const unsigned int& seconds);
+	
+	AI_LOD get_lod() const;
+	// note: this is set by the ai_store when scheduling the think phase
+	void set_lod(const AI_LOD& lod);
 
 protected:
 	float3 move_position;
@@ -73,6 +82,17 @@ protected:
 	const float attack_distance = 2.0f;
 	float3 target_position;
 	float3 prev_pos;
+	
+	// player position of the current physics snapshot
+	float3 player_position;
+	// set in the think phase, the attack itself is executed in physics_update
+	bool attack_pending = false;
+	// note: core::rand can't be used in the (parallel) think phase
+	minstd_rand rng;
+	
+	// level of detail (copy of the ai_store state, also read by the render thread)
+	atomic<AI_LOD> lod { AI_LOD::FULL };
+	bool is_idle() const;
 
 	AI_TARGET_MODE target_mode = AI_TARGET_MODE::NONE;
 
@@ -80,13 +100,25 @@ protected:
 	sb_map::ai_waypoint* cur_waypoint = nullptr;
 	void next_waypoint();
 	void check_waypoint();
+	
+	// path to the current waypoint (computed by the map pathfinder)
+	pathfinder* pf;
+	vector<uint3> path;
+	size_t path_index = 0;
+	void request_waypoint_path();
+	void follow_path();
+	void move_to_block(const uint3& block);
 
 	const float weapon_strength = 40.0f;
 	
 	array<float2, 32> avg_rotation;
 	size_t avg_rotation_index = 0;
+	bool avg_rotation_valid = false;
 	
-	//
+	// borrowed from the map renderer for the duration of an attack
+	// note: attacks happen on the physics thread, but the particle system is only ever touched in graphics_update
+	// -> the attack is queued via its start time (0 = no pending attack)
+	atomic<unsigned int> attack_start_ticks { 0 };
 	particle_system* attack_ps = nullptr;
 	unsigned int attack_ps_timer = 0;
 	
@@ -0,0 +1,129 @@
+/*
+ *  Blocks In Motion
+ *  Copyright (C) 2012 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "ai_store.h"
+#include "ai_entity.h"
+#include "game.h"
+
+// lod distances and think intervals (in ms)
+static constexpr float lod_full_distance = 16.0f;
+static constexpr float lod_reduced_distance = 48.0f;
+static constexpr float lod_promote_distance = 8.0f; // block changes within this distance promote to full lod ...
+static constexpr unsigned int lod_promote_duration = 2000; // ... for this long
+static constexpr unsigned int lod_reduced_interval = 25;
+static constexpr unsigned int lod_minimal_interval = 100;
+
+void ai_store::add(ai_entity* ai) {
+	entities.push_back(ai);
+	positions.push_back(ai->get_position());
+	lods.push_back(AI_LOD::FULL);
+	next_think_ticks.push_back(0);
+	promote_ticks.push_back(0);
+	player_visible.push_back(0);
+}
+
+void ai_store::remove(ai_entity* ai) {
+	const auto iter = find(begin(entities), end(entities), ai);
+	if(iter == end(entities)) return;
+	
+	// swap with the last ai and pop
+	const size_t index = (size_t)distance(begin(entities), iter);
+	const size_t last = entities.size() - 1;
+	entities[index] = entities[last];
+	positions[index] = positions[last];
+	lods[index] = lods[last];
+	next_think_ticks[index] = next_think_ticks[last];
+	promote_ticks[index] = promote_ticks[last];
+	player_visible[index] = player_visible[last];
+	entities.pop_back();
+	positions.pop_back();
+	lods.pop_back();
+	next_think_ticks.pop_back();
+	promote_ticks.pop_back();
+	player_visible.pop_back();
+}
+
+void ai_store::clear() {
+	entities.clear();
+	positions.clear();
+	lods.clear();
+	next_think_ticks.clear();
+	promote_ticks.clear();
+	player_visible.clear();
+}
+
+void ai_store::schedule(const physics_snapshot& snapshot, vector<physics_entity*>& think_list) {
+	const size_t count = entities.size();
+	for(size_t i = 0; i < count; i++) {
+		positions[i] = entities[i]->get_position();
+	}
+	
+	// promote all ais near changed blocks
+	for(const auto& block : snapshot.changed_blocks) {
+		const float3 block_center(float3(block) + 0.5f);
+		for(size_t i = 0; i < count; i++) {
+			if(block_center.distance(positions[i]) < lod_promote_distance) {
+				promote_ticks[i] = snapshot.ticks + lod_promote_duration;
+			}
+		}
+	}
+	
+	for(size_t i = 0; i < count; i++) {
+		const bool due = (snapshot.ticks >= next_think_ticks[i]);
+		AI_LOD lod = AI_LOD::MINIMAL;
+		const float dist = (snapshot.player_position - positions[i]).length();
+		if(dist < lod_full_distance || snapshot.ticks < promote_ticks[i]) {
+			lod = AI_LOD::FULL;
+		}
+		else if(dist < lod_reduced_distance) {
+			// note: the visibility is only checked when due, the los result is cached in any case
+			if(due) {
+				player_visible[i] = (ge->is_in_line_of_sight(positions[i], lod_reduced_distance) ? 1 : 0);
+			}
+			lod = (player_visible[i] != 0 ? AI_LOD::FULL : AI_LOD::REDUCED);
+		}
+		
+		if(lod != lods[i]) {
+			// promoted -> think right away
+			if(lod < lods[i]) next_think_ticks[i] = 0;
+			lods[i] = lod;
+			entities[i]->set_lod(lod);
+		}
+		
+		if(snapshot.ticks < next_think_ticks[i]) continue;
+		switch(lod) {
+			case AI_LOD::FULL: next_think_ticks[i] = 0; break;
+			case AI_LOD::REDUCED: next_think_ticks[i] = snapshot.ticks + lod_reduced_interval; break;
+			case AI_LOD::MINIMAL: next_think_ticks[i] = snapshot.ticks + lod_minimal_interval; break;
+		}
+		think_list.push_back(entities[i]);
+	}
+}
+
+const vector<ai_entity*>& ai_store::get_entities() const {
+	return entities;
+}
+
+array<size_t, 3> ai_store::get_lod_counts() const {
+	array<size_t, 3> counts { { 0, 0, 0 } };
+	for(const auto& lod : lods) {
+		counts[(size_t)lod]++;
+	}
+	return counts;
+}
@@ -0,0 +1,60 @@
+/*
+ *  Blocks In Motion
+ *  Copyright (C) 2012 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SB_AI_STORE_H__
+#define __SB_AI_STORE_H__
+
+#include "sb_global.h"
+
+// level of detail of the ai update, depending on the distance and visibility to the player
+enum class AI_LOD : unsigned char {
+	FULL, // near, visible or close to a block change: thinks every physics step, smoothed rotation
+	REDUCED, // medium distance: thinks at a reduced rate
+	MINIMAL, // far away: thinks at a low rate, stops patrolling and lets its body sleep when idle
+};
+
+// data-oriented storage of the per-ai scheduling state (lod and think timing): all ais are updated
+// in one batch per physics step and only the ais that are due are handed to the think phase.
+// note: add/remove/clear must be called while the physics lock is held
+class ai_entity;
+class physics_entity;
+struct physics_snapshot;
+class ai_store {
+public:
+	void add(ai_entity* ai);
+	void remove(ai_entity* ai);
+	void clear();
+	
+	// updates the lod of all ais and appends all ais that have to think in this step to think_list
+	void schedule(const physics_snapshot& snapshot, vector<physics_entity*>& think_list);
+	
+	const vector<ai_entity*>& get_entities() const;
+	array<size_t, 3> get_lod_counts() const;
+	
+protected:
+	vector<ai_entity*> entities;
+	vector<float3> positions;
+	vector<AI_LOD> lods;
+	vector<unsigned int> next_think_ticks;
+	vector<unsigned int> promote_ticks; // full lod until then (after a nearby block change)
+	vector<unsigned char> player_visible; // only updated while in REDUCED lod
+	
+};
+
+#endif
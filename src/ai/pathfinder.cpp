@@ -0,0 +1,330 @@
+/*
+ *  Blocks In Motion
+ *  Copyright (C) 2012 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "pathfinder.h"
+#include "sb_map.h"
+
+constexpr int pathfinder::flow_field_radius;
+constexpr int pathfinder::flow_field_height;
+constexpr size_t pathfinder::max_path_nodes;
+
+// paths are only repaired if a changed block is this close to one of their nodes
+static constexpr int path_repair_distance = 2;
+
+// possible moves: 4 horizontal directions, each on the same level, one block up or one block down
+static const array<int3, 12> moves {
+	{
+		int3(1, 0, 0), int3(-1, 0, 0), int3(0, 0, 1), int3(0, 0, -1),
+		int3(1, 1, 0), int3(-1, 1, 0), int3(0, 1, 1), int3(0, 1, -1),
+		int3(1, -1, 0), int3(-1, -1, 0), int3(0, -1, 1), int3(0, -1, -1),
+	}
+};
+static constexpr unsigned char flow_unreachable = 0xFF;
+static constexpr unsigned char flow_target_reached = 0xFE;
+static const int3 flow_field_size(pathfinder::flow_field_radius * 2 + 1,
+								  pathfinder::flow_field_height * 2 + 1,
+								  pathfinder::flow_field_radius * 2 + 1);
+
+pathfinder::pathfinder() : thread_base("pathfinder"),
+evt_handler_fnctr(this, &pathfinder::event_handler) {
+	eevt->add_event_handler(evt_handler_fnctr, EVENT_TYPE::BLOCK_CHANGE, EVENT_TYPE::PLAYER_BLOCK_STEP);
+	this->set_thread_delay(20);
+	this->start();
+}
+
+pathfinder::~pathfinder() {
+	eevt->remove_event_handler(evt_handler_fnctr);
+	this->finish();
+}
+
+pathfinder::CELL pathfinder::material_to_cell(const BLOCK_MATERIAL& mat) {
+	switch(mat) {
+		case BLOCK_MATERIAL::NONE: return CELL::AIR;
+		case BLOCK_MATERIAL::ACID: return CELL::BLOCKED;
+		default: break;
+	}
+	return CELL::SOLID;
+}
+
+void pathfinder::rebuild(const sb_map& map) {
+	const uint3 map_extent(map.get_chunk_count() * sb_map::chunk_extent);
+	vector<CELL> new_cells(map_extent.x * map_extent.y * map_extent.z, CELL::AIR);
+	const auto& chunks(map.get_chunks());
+	for(unsigned int chunk_index = 0, chunk_count = (unsigned int)chunks.size(); chunk_index < chunk_count; chunk_index++) {
+		if(map.get_chunk_block_count(chunk_index) == 0) continue;
+		const uint3 chunk_origin(map.chunk_index_to_position(chunk_index) * sb_map::chunk_extent);
+		for(unsigned int block_index = 0; block_index < sb_map::blocks_per_chunk; block_index++) {
+			const uint3 pos(chunk_origin + sb_map::block_index_to_position(block_index));
+			new_cells[(pos.y * map_extent.z + pos.z) * map_extent.x + pos.x] = material_to_cell(chunks[chunk_index][block_index].material);
+		}
+	}
+	
+	lock_guard<mutex> guard(data_lock);
+	pending_cells.swap(new_cells);
+	pending_extent = int3(map_extent);
+	has_pending_cells = true;
+	pending_changes.clear();
+}
+
+void pathfinder::request_path(const ai_entity* ai, const uint3& from, const uint3& to) {
+	lock_guard<mutex> guard(data_lock);
+	path_request& request(requests[ai]);
+	request.from = from;
+	request.to = to;
+	request.dirty = true;
+	request.updated = false;
+}
+
+bool pathfinder::get_path(const ai_entity* ai, vector<uint3>& path) {
+	lock_guard<mutex> guard(data_lock);
+	const auto iter = requests.find(ai);
+	if(iter == requests.end() || !iter->second.updated) return false;
+	iter->second.updated = false;
+	path = iter->second.path;
+	return true;
+}
+
+void pathfinder::cancel_path(const ai_entity* ai) {
+	lock_guard<mutex> guard(data_lock);
+	requests.erase(ai);
+}
+
+bool pathfinder::get_flow_step(const uint3& position, uint3& next_position) const {
+	lock_guard<mutex> guard(data_lock);
+	if(flow_directions.empty()) return false;
+	const int3 local_pos(int3(position) - flow_origin);
+	if(local_pos.x < 0 || local_pos.y < 0 || local_pos.z < 0 ||
+	   local_pos.x >= flow_field_size.x || local_pos.y >= flow_field_size.y || local_pos.z >= flow_field_size.z) {
+		return false;
+	}
+	const unsigned char dir(flow_directions[size_t((local_pos.y * flow_field_size.z + local_pos.z) * flow_field_size.x + local_pos.x)]);
+	if(dir >= moves.size()) return false;
+	next_position = uint3(int3(position) + moves[dir]);
+	return true;
+}
+
+pathfinder::CELL pathfinder::get_cell(const int3& pos) const {
+	// everything outside of the map is considered solid
+	if(pos.x < 0 || pos.y < 0 || pos.z < 0 ||
+	   pos.x >= extent.x || pos.y >= extent.y || pos.z >= extent.z) {
+		return CELL::SOLID;
+	}
+	return cells[size_t((pos.y * extent.z + pos.z) * extent.x + pos.x)];
+}
+
+bool pathfinder::is_walkable(const int3& pos) const {
+	return (get_cell(pos - int3(0, 1, 0)) == CELL::SOLID &&
+			get_cell(pos) == CELL::AIR &&
+			get_cell(pos + int3(0, 1, 0)) == CELL::AIR);
+}
+
+bool pathfinder::can_move(const int3& from, const int3& delta) const {
+	if(!is_walkable(from + delta)) return false;
+	// stepping up requires head room above the start block, stepping down requires head room above the destination
+	if(delta.y > 0) return (get_cell(from + int3(0, 2, 0)) == CELL::AIR);
+	if(delta.y < 0) return (get_cell(from + delta + int3(0, 2, 0)) == CELL::AIR);
+	return true;
+}
+
+bool pathfinder::find_path(const int3& from, const int3& to, vector<uint3>& path) const {
+	path.clear();
+	if(!is_walkable(from) || !is_walkable(to)) return false;
+	
+	const auto heuristic = [&to](const int3& pos) -> unsigned int {
+		return (unsigned int)(abs(to.x - pos.x) + abs(to.y - pos.y) + abs(to.z - pos.z));
+	};
+	struct node_info {
+		int3 parent;
+		unsigned int cost;
+		bool closed;
+	};
+	unordered_map<unsigned long long int, node_info> nodes;
+	// <estimated total cost, position>
+	typedef pair<unsigned int, int3> open_node;
+	const auto open_cmp = [](const open_node& lhs, const open_node& rhs) { return lhs.first > rhs.first; };
+	priority_queue<open_node, vector<open_node>, decltype(open_cmp)> open_nodes(open_cmp);
+	
+	nodes[sb_map::pack_position(uint3(from))] = node_info { from, 0, false };
+	open_nodes.push(open_node { heuristic(from), from });
+	
+	size_t expansions = 0;
+	while(!open_nodes.empty() && expansions < max_path_nodes) {
+		const int3 pos(open_nodes.top().second);
+		open_nodes.pop();
+		node_info& info(nodes[sb_map::pack_position(uint3(pos))]);
+		if(info.closed) continue;
+		info.closed = true;
+		expansions++;
+		
+		if((pos == to).all()) {
+			// found -> walk back to the start
+			for(int3 cur_pos(pos); !(cur_pos == from).all(); cur_pos = nodes[sb_map::pack_position(uint3(cur_pos))].parent) {
+				path.emplace_back(cur_pos);
+			}
+			reverse(begin(path), end(path));
+			return true;
+		}
+		
+		const unsigned int cost(info.cost + 1);
+		for(const auto& move : moves) {
+			if(!can_move(pos, move)) continue;
+			const int3 next_pos(pos + move);
+			const auto next_iter = nodes.find(sb_map::pack_position(uint3(next_pos)));
+			if(next_iter != nodes.end() && (next_iter->second.closed || next_iter->second.cost <= cost)) continue;
+			nodes[sb_map::pack_position(uint3(next_pos))] = node_info { pos, cost, false };
+			open_nodes.push(open_node { cost + heuristic(next_pos), next_pos });
+		}
+	}
+	return false;
+}
+
+void pathfinder::compute_flow_field(const int3& target) {
+	const int3 origin(target - int3(flow_field_radius, flow_field_height, flow_field_radius));
+	vector<unsigned char> directions(size_t(flow_field_size.x * flow_field_size.y * flow_field_size.z), flow_unreachable);
+	const auto local_index = [&origin](const int3& pos) -> size_t {
+		const int3 local_pos(pos - origin);
+		return size_t((local_pos.y * flow_field_size.z + local_pos.z) * flow_field_size.x + local_pos.x);
+	};
+	const auto in_field = [&origin](const int3& pos) -> bool {
+		const int3 local_pos(pos - origin);
+		return (local_pos.x >= 0 && local_pos.y >= 0 && local_pos.z >= 0 &&
+				local_pos.x < flow_field_size.x && local_pos.y < flow_field_size.y && local_pos.z < flow_field_size.z);
+	};
+	
+	// breadth-first search from the target: each reached block stores the move toward the target
+	if(is_walkable(target)) {
+		deque<int3> queue { target };
+		directions[local_index(target)] = flow_target_reached;
+		while(!queue.empty()) {
+			const int3 pos(queue.front());
+			queue.pop_front();
+			for(unsigned char dir = 0; dir < moves.size(); dir++) {
+				const int3 prev_pos(pos - moves[dir]);
+				if(!in_field(prev_pos) || directions[local_index(prev_pos)] != flow_unreachable) continue;
+				if(!can_move(prev_pos, moves[dir])) continue;
+				directions[local_index(prev_pos)] = dir;
+				queue.push_back(prev_pos);
+			}
+		}
+	}
+	
+	lock_guard<mutex> guard(data_lock);
+	flow_origin = origin;
+	flow_directions.swap(directions);
+}
+
+void pathfinder::run() {
+	vector<pair<const ai_entity*, path_request>> dirty_requests;
+	bool update_flow_field = false;
+	int3 target;
+	{
+		lock_guard<mutex> guard(data_lock);
+		if(has_pending_cells) {
+			// complete rebuild -> everything must be recomputed
+			cells.swap(pending_cells);
+			pending_cells.clear();
+			extent = pending_extent;
+			has_pending_cells = false;
+			flow_dirty = true;
+			for(auto& request : requests) {
+				request.second.dirty = true;
+			}
+		}
+		
+		// apply block changes and repair everything they affect
+		for(const auto& change : pending_changes) {
+			const int3 pos(change.first);
+			if((pos >= extent).any()) continue;
+			cells[size_t((pos.y * extent.z + pos.z) * extent.x + pos.x)] = change.second;
+			
+			if(!flow_directions.empty()) {
+				// note: a change can only influence the walkability of the blocks up to two above and below it
+				// (floor and head room checks in can_move) -> the field bounds have a margin of 2 in y
+				const int3 local_pos(pos - flow_origin);
+				if(local_pos.x >= 0 && local_pos.z >= 0 && local_pos.y >= -2 &&
+				   local_pos.x < flow_field_size.x && local_pos.z < flow_field_size.z && local_pos.y < flow_field_size.y + 2) {
+					flow_dirty = true;
+				}
+			}
+			
+			for(auto& request : requests) {
+				if(request.second.dirty) continue;
+				if(request.second.path.empty()) {
+					// no path (yet) -> retry if the change is somewhere between start and destination
+					const int3 bbox_min(int3::min(int3(request.second.from), int3(request.second.to)) - path_repair_distance);
+					const int3 bbox_max(int3::max(int3(request.second.from), int3(request.second.to)) + path_repair_distance);
+					if((pos >= bbox_min).all() && (pos <= bbox_max).all()) {
+						request.second.dirty = true;
+					}
+					continue;
+				}
+				for(const auto& node : request.second.path) {
+					const int3 diff(int3(node) - pos);
+					if(abs(diff.x) <= path_repair_distance && abs(diff.y) <= path_repair_distance && abs(diff.z) <= path_repair_distance) {
+						request.second.dirty = true;
+						break;
+					}
+				}
+			}
+		}
+		pending_changes.clear();
+		
+		for(auto& request : requests) {
+			if(!request.second.dirty) continue;
+			request.second.dirty = false;
+			dirty_requests.emplace_back(request);
+		}
+		update_flow_field = flow_dirty;
+		flow_dirty = false;
+		target = int3(flow_target);
+	}
+	
+	// compute paths (w/o holding the lock)
+	for(auto& request : dirty_requests) {
+		find_path(int3(request.second.from), int3(request.second.to), request.second.path);
+		
+		lock_guard<mutex> guard(data_lock);
+		const auto iter = requests.find(request.first);
+		// discard if the request has been canceled or replaced in the meantime
+		if(iter == requests.end() || iter->second.dirty) continue;
+		iter->second.path.swap(request.second.path);
+		iter->second.updated = true;
+	}
+	
+	if(update_flow_field) {
+		compute_flow_field(target);
+	}
+}
+
+bool pathfinder::event_handler(EVENT_TYPE type, shared_ptr<event_object> obj) {
+	if(type == EVENT_TYPE::BLOCK_CHANGE) {
+		const shared_ptr<block_change_event>& change_evt = (shared_ptr<block_change_event>&)obj;
+		lock_guard<mutex> guard(data_lock);
+		pending_changes.emplace_back(change_evt->position, material_to_cell(change_evt->new_material));
+		return true;
+	}
+	else if(type == EVENT_TYPE::PLAYER_BLOCK_STEP) {
+		const shared_ptr<player_block_step_event>& step_evt = (shared_ptr<player_block_step_event>&)obj;
+		lock_guard<mutex> guard(data_lock);
+		flow_target = step_evt->block;
+		flow_dirty = true;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,99 @@
+/*
+ *  Blocks In Motion
+ *  Copyright (C) 2012 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SB_PATHFINDER_H__
+#define __SB_PATHFINDER_H__
+
+#include "sb_global.h"
+#include <threading/thread_base.h>
+#include <gui/event.h>
+
+// voxel pathfinding over the walkable blocks of a map (a block is walkable if the block below it
+// is solid and it and the block above it are empty). paths are computed on a separate thread:
+//  * per-ai paths via A* (request_path/get_path)
+//  * a shared flow field toward the player, which covers a box around the player's block
+// both are repaired incrementally when blocks change (BLOCK_CHANGE events).
+class sb_map;
+class ai_entity;
+class pathfinder : public thread_base {
+public:
+	pathfinder();
+	virtual ~pathfinder();
+	
+	virtual void run();
+	
+	// must be called after the map has been resized (copies all block data)
+	void rebuild(const sb_map& map);
+	
+	// requests a path for the ai (replaces any previous request of this ai)
+	void request_path(const ai_entity* ai, const uint3& from, const uint3& to);
+	// returns true if a new path is available (note: the path excludes the start block and is empty if there is no path)
+	bool get_path(const ai_entity* ai, vector<uint3>& path);
+	void cancel_path(const ai_entity* ai);
+	
+	// returns false if the position isn't covered by the flow field or the player can't be reached from it
+	bool get_flow_step(const uint3& position, uint3& next_position) const;
+	
+	static constexpr int flow_field_radius = 24; // horizontal
+	static constexpr int flow_field_height = 8; // vertical
+	static constexpr size_t max_path_nodes = 4096; // max amount of A* node expansions
+	
+protected:
+	enum class CELL : unsigned char {
+		AIR,
+		SOLID,
+		BLOCKED, // neither walkable on nor passable (e.g. acid)
+	};
+	static CELL material_to_cell(const BLOCK_MATERIAL& mat);
+	
+	// all of this is only accessed by the pathfinding thread
+	vector<CELL> cells;
+	int3 extent;
+	CELL get_cell(const int3& pos) const;
+	bool is_walkable(const int3& pos) const;
+	bool can_move(const int3& from, const int3& delta) const;
+	bool find_path(const int3& from, const int3& to, vector<uint3>& path) const;
+	void compute_flow_field(const int3& target);
+	
+	struct path_request {
+		uint3 from;
+		uint3 to;
+		vector<uint3> path;
+		bool dirty; // must be (re)computed
+		bool updated; // new path available
+	};
+	
+	// shared data (guarded by data_lock)
+	mutable mutex data_lock;
+	unordered_map<const ai_entity*, path_request> requests;
+	vector<pair<uint3, CELL>> pending_changes;
+	vector<CELL> pending_cells;
+	int3 pending_extent;
+	bool has_pending_cells = false;
+	uint3 flow_target;
+	bool flow_dirty = false;
+	int3 flow_origin;
+	vector<unsigned char> flow_directions; // index into the move table, 0xFF if unreachable
+	
+	event::handler evt_handler_fnctr;
+	bool event_handler(EVENT_TYPE type, shared_ptr<event_object> obj);
+	
+};
+
+#endif
@@ -524,16 +524,14 @@ void editor::open_object_ui(const OBJECT_TYPE& type, void* ptr a2e_unused) {
 				}
 				
 				sb_map::map_link* ml = (sb_map::map_link*)object_selection.get_ptr();
-				for(auto pos_iter = begin(ml->positions); pos_iter != end(ml->positions);) {
-					const uint3 moved_pos(int3(*pos_iter) + dir);
+				vector<uint3> positions;
+				for(const auto& pos : ml->positions) {
+					const uint3 moved_pos(int3(pos) + dir);
 					if(active_map->is_valid_position(moved_pos)) {
-						*pos_iter = moved_pos;
-						pos_iter++;
-					}
-					else {
-						pos_iter = ml->positions.erase(pos_iter);
+						positions.emplace_back(moved_pos);
 					}
 				}
+				active_map->set_map_link_positions(ml, positions);
 				if(ml->positions.empty()) {
 					object_selection.reset();
 					active_map->remove_map_link(ml);
@@ -566,9 +564,10 @@ void editor::open_object_ui(const OBJECT_TYPE& type, void* ptr a2e_unused) {
 				
 				// note: this will only change the size in the positive direction
 				sb_map::map_link* ml = (sb_map::map_link*)object_selection.get_ptr();
-				if(!ml->positions.empty()) {
-					uint3 bbox_min(ml->positions[0]), bbox_max(ml->positions[0]);
-					for(const auto& pos : ml->positions) {
+				vector<uint3> positions(ml->positions);
+				if(!positions.empty()) {
+					uint3 bbox_min(positions[0]), bbox_max(positions[0]);
+					for(const auto& pos : positions) {
 						bbox_min.min(pos);
 						bbox_max.max(pos);
 					}
@@ -585,7 +584,7 @@ void editor::open_object_ui(const OBJECT_TYPE& type, void* ptr a2e_unused) {
 								layer_pos[layer.y] = j;
 								const uint3 block_pos(add_pos + layer_pos);
 								if(active_map->is_valid_position(block_pos)) {
-									ml->positions.emplace_back(block_pos);
+									positions.emplace_back(block_pos);
 								}
 							}
 						}
@@ -593,13 +592,14 @@ void editor::open_object_ui(const OBJECT_TYPE& type, void* ptr a2e_unused) {
 					// decrease
 					else {
 						const unsigned int dec_value = (bbox_max * dir);
-						for(auto pos_iter = begin(ml->positions); pos_iter != end(ml->positions);) {
+						for(auto pos_iter = begin(positions); pos_iter != end(positions);) {
 							if((*pos_iter)[dir_component] == dec_value) {
-								pos_iter = ml->positions.erase(pos_iter);
+								pos_iter = positions.erase(pos_iter);
 							}
 							else pos_iter++;
 						}
 					}
+					active_map->set_map_link_positions(ml, positions);
 				}
 				if(ml->positions.empty()) {
 					object_selection.reset();
@@ -630,7 +630,7 @@ void editor::open_object_ui(const OBJECT_TYPE& type, void* ptr a2e_unused) {
 			map_link_ui.identifier_input->add_handler([this](GUI_EVENT, gui_object&) {
 				e->acquire_gl_context();
 				sb_map::map_link* ml = (sb_map::map_link*)object_selection.get_ptr();
-				ml->identifier = map_link_ui.identifier_input->get_input();
+				active_map->set_map_link_identifier(ml, map_link_ui.identifier_input->get_input());
 				ui->set_active_object(nullptr); // make input box inactive
 				e->release_gl_context();
 			}, GUI_EVENT::INPUT_BOX_ENTER);
@@ -723,7 +723,7 @@ void editor::open_object_ui(const OBJECT_TYPE& type, void* ptr a2e_unused) {
 				sb_map::trigger* trgr = (sb_map::trigger*)object_selection.get_ptr();
 				const uint3 new_pos(int3(trgr->position) + dir);
 				if(active_map->is_valid_position(new_pos)) {
-					trgr->position = new_pos;
+					active_map->move_trigger(trgr, new_pos);
 				}
 				
 				e->release_gl_context();
@@ -779,7 +779,7 @@ void editor::open_object_ui(const OBJECT_TYPE& type, void* ptr a2e_unused) {
 						trgr->on_untrigger,
 						// dependent data:
 						(trgr->weight <= EPSILON && new_type == TRIGGER_TYPE::WEIGHT ?
-						 0.1f : 0.0f),
+						 physics_controller::character_mass : 0.0f),
 						trgr->intensity,
 						trgr->time,
 						sb_map::trigger::state_struct()
@@ -857,7 +857,7 @@ void editor::open_object_ui(const OBJECT_TYPE& type, void* ptr a2e_unused) {
 			trigger_ui.identifier_input->add_handler([this](GUI_EVENT, gui_object&) {
 				e->acquire_gl_context();
 				sb_map::trigger* trgr = (sb_map::trigger*)object_selection.get_ptr();
-				trgr->identifier = trigger_ui.identifier_input->get_input();
+				active_map->set_trigger_identifier(trgr, trigger_ui.identifier_input->get_input());
 				ui->set_active_object(nullptr); // make input box inactive
 				e->release_gl_context();
 			}, GUI_EVENT::INPUT_BOX_ENTER);
@@ -930,16 +930,15 @@ void editor::open_object_ui(const OBJECT_TYPE& type, void* ptr a2e_unused) {
 				
 				sb_map::light_color_area* lca = (sb_map::light_color_area*)object_selection.get_ptr();
 				const uint3 new_min_pos(int3(lca->min_pos) + dir), new_max_pos(int3(lca->max_pos) + dir);
-				if(active_map->is_valid_position(new_min_pos)) {
-					lca->min_pos = new_min_pos;
-				}
+				const uint3 min_pos(active_map->is_valid_position(new_min_pos) ? new_min_pos : lca->min_pos);
 				
 				const uint3 map_max_pos(sb_map::chunk_extent * active_map->get_chunk_count());
-				lca->max_pos.x = new_max_pos.x < map_max_pos.x ? new_max_pos.x : map_max_pos.x;
-				lca->max_pos.y = new_max_pos.y < map_max_pos.y ? new_max_pos.y : map_max_pos.y;
-				lca->max_pos.z = new_max_pos.z < map_max_pos.z ? new_max_pos.z : map_max_pos.z;
+				uint3 max_pos;
+				max_pos.x = new_max_pos.x < map_max_pos.x ? new_max_pos.x : map_max_pos.x;
+				max_pos.y = new_max_pos.y < map_max_pos.y ? new_max_pos.y : map_max_pos.y;
+				max_pos.z = new_max_pos.z < map_max_pos.z ? new_max_pos.z : map_max_pos.z;
 				
-				active_map->update_light_colors();
+				active_map->update_light_color_area(lca, min_pos, max_pos, lca->color);
 				e->release_gl_context();
 			});
 			next_height();
@@ -963,14 +962,15 @@ void editor::open_object_ui(const OBJECT_TYPE& type, void* ptr a2e_unused) {
 				sb_map::light_color_area* lca = (sb_map::light_color_area*)object_selection.get_ptr();
 				const uint3 new_max_pos(int3(lca->max_pos) + dir);
 				const uint3 map_max_pos(sb_map::chunk_extent * active_map->get_chunk_count());
-				lca->max_pos.x = new_max_pos.x < map_max_pos.x ? new_max_pos.x : map_max_pos.x;
-				lca->max_pos.y = new_max_pos.y < map_max_pos.y ? new_max_pos.y : map_max_pos.y;
-				lca->max_pos.z = new_max_pos.z < map_max_pos.z ? new_max_pos.z : map_max_pos.z;
-				lca->max_pos.x = lca->max_pos.x < lca->min_pos.x ? lca->min_pos.x : lca->max_pos.x;
-				lca->max_pos.y = lca->max_pos.y < lca->min_pos.y ? lca->min_pos.y : lca->max_pos.y;
-				lca->max_pos.z = lca->max_pos.z < lca->min_pos.z ? lca->min_pos.z : lca->max_pos.z;
+				uint3 max_pos;
+				max_pos.x = new_max_pos.x < map_max_pos.x ? new_max_pos.x : map_max_pos.x;
+				max_pos.y = new_max_pos.y < map_max_pos.y ? new_max_pos.y : map_max_pos.y;
+				max_pos.z = new_max_pos.z < map_max_pos.z ? new_max_pos.z : map_max_pos.z;
+				max_pos.x = max_pos.x < lca->min_pos.x ? lca->min_pos.x : max_pos.x;
+				max_pos.y = max_pos.y < lca->min_pos.y ? lca->min_pos.y : max_pos.y;
+				max_pos.z = max_pos.z < lca->min_pos.z ? lca->min_pos.z : max_pos.z;
 				
-				active_map->update_light_colors();
+				active_map->update_light_color_area(lca, lca->min_pos, max_pos, lca->color);
 				e->release_gl_context();
 			});
 			next_height();
@@ -986,8 +986,7 @@ void editor::open_object_ui(const OBJECT_TYPE& type, void* ptr a2e_unused) {
 									   light_color_area_ui.light_color_sliders[1]->get_knob_position(),
 									   light_color_area_ui.light_color_sliders[2]->get_knob_position());
 					sb_map::light_color_area* lca = (sb_map::light_color_area*)object_selection.get_ptr();
-					lca->color = color;
-					active_map->update_light_colors();
+					active_map->update_light_color_area(lca, lca->min_pos, lca->max_pos, color);
 					e->release_gl_context();
 				}, GUI_EVENT::SLIDER_MOVE);
 			}
@@ -1044,7 +1043,7 @@ void editor::open_object_ui(const OBJECT_TYPE& type, void* ptr a2e_unused) {
 			ai_waypoint_ui.identifier_input->add_handler([this](GUI_EVENT, gui_object&) {
 				e->acquire_gl_context();
 				sb_map::ai_waypoint* wp = (sb_map::ai_waypoint*)object_selection.get_ptr();
-				wp->identifier = ai_waypoint_ui.identifier_input->get_input();
+				active_map->set_ai_waypoint_identifier(wp, ai_waypoint_ui.identifier_input->get_input());
 				ui->set_active_object(nullptr); // make input box inactive
 				e->release_gl_context();
 			}, GUI_EVENT::INPUT_BOX_ENTER);
@@ -1057,13 +1056,7 @@ void editor::open_object_ui(const OBJECT_TYPE& type, void* ptr a2e_unused) {
 					wp->next = nullptr;
 				}
 				else {
-					wp->next = nullptr;
-					for(const auto& ai_wp : active_map->get_ai_waypoints()) {
-						if(ai_wp->identifier == next_str) {
-							wp->next = ai_wp;
-							break;
-						}
-					}
+					wp->next = active_map->get_ai_waypoint(next_str);
 				}
 				e->release_gl_context();
 			}, GUI_EVENT::POP_UP_BUTTON_SELECT);
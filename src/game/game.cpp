@@ -101,6 +101,7 @@ static char4 grad4[32] = { char4(0,1,1,1), char4(0,1,1,-1), char4(0,1,-1,1), cha
 game::game(const float3& position) :
 physics_player(position),
 action_handler_fct(this, &game::action_handler),
+los_handler_fct(this, &game::los_handler),
 gui_callback(this, &game::draw_interface),
 rendering_scene_callback(this, &game::draw_active_cube_hud) {
 	old_tick = tick_push = SDL_GetTicks();
@@ -148,6 +149,13 @@ rendering_scene_callback(this, &game::draw_active_cube_hud) {
 									 EVENT_TYPE::MOUSE_RIGHT_UP,
 									 EVENT_TYPE::MOUSE_MIDDLE_DOWN,
 									 EVENT_TYPE::MOUSE_MIDDLE_UP);
+	eevt->add_event_handler(los_handler_fct,
+							EVENT_TYPE::BLOCK_CHANGE,
+							EVENT_TYPE::PLAYER_BLOCK_STEP,
+							EVENT_TYPE::AI_BLOCK_STEP,
+							EVENT_TYPE::AI_DESTROY,
+							EVENT_TYPE::MAP_LOAD,
+							EVENT_TYPE::MAP_UNLOAD);
 
 	create_cube(cube_vbo[CUBE_VBO_INDEX_VERT], cube_vbo[CUBE_VBO_INDEX_INDEX]);
 	create_cube_tex_n_bn_tn(cube_vbo[CUBE_VBO_INDEX_TEX], cube_vbo[CUBE_VBO_INDEX_NORMAL],
@@ -195,6 +203,7 @@ rendering_scene_callback(this, &game::draw_active_cube_hud) {
 
 game::~game() {
 	eevt->remove_event_handler(action_handler_fct);
+	eevt->remove_event_handler(los_handler_fct);
 	set_enabled(false);
 	t->delete_texture(death_tex);
 	// eleminate cubes
@@ -534,27 +543,28 @@ void game::draw_active_cube_hud(const DRAW_MODE draw_mode) {
 }
 
 bool game::handle_object(const WEAPON_MODE& weapon_mode) {
-	// try to find a static block first
-	const game_base::static_intersection static_int(game_base::intersect_static());
-	const game_base::dynamic_intersection dynamic_int(game_base::intersect_dynamic());
-	const game_base::ai_intersection ai_int(game_base::intersect_ai());
+	// find the nearest static block, dynamic block or ai
+	const game_base::ray_query_result intersection(game_base::query_ray(ray_query {
+		game_base::compute_camera_scene_ray(), RAY_CATEGORY::ALL, max_selection_distance
+	}));
+	const game_base::static_intersection& static_int(intersection.static_hit);
+	const game_base::dynamic_intersection& dynamic_int(intersection.dynamic_hit);
+	const game_base::ai_intersection& ai_int(intersection.ai_hit);
 	body = nullptr;
-	float dist = static_int.distance;
-	if(!static_int.is_invalid() && dist < dynamic_int.distance) {
+	if(intersection.category == RAY_CATEGORY::STATIC) {
 		// take static match
 		if(static_int.material == BLOCK_MATERIAL::METAL) {
 			body = active_map->resolve_dynamic(static_int.get_block_pos());
 			selected_block_mat = static_int.material;
 		}
 	}
-	else if(dynamic_int.kind != BLOCK_MATERIAL::NONE) {
+	else if(intersection.category == RAY_CATEGORY::DYNAMIC && dynamic_int.kind != BLOCK_MATERIAL::NONE) {
 		// take dynamic block
 		body = dynamic_int.body;
 		selected_block_mat = dynamic_int.kind;
-		dist = dynamic_int.distance;
 	}
 
-	if(!ai_int.is_invalid() && (body == nullptr || dist > ai_int.distance)) {
+	if(intersection.category == RAY_CATEGORY::AI) {
 		// extra push handling for AI
 		if(weapon_mode != WEAPON_MODE::FORCE) return false;
 		body = ai_int.ai->get_character_body();
@@ -570,6 +580,11 @@ bool game::handle_object(const WEAPON_MODE& weapon_mode) {
 		// nothing found
 		return false;
 	}
+	
+	// the selected body (and its island) might be sleeping -> wake it up
+	pc->lock();
+	body->get_body()->activate(true);
+	pc->unlock();
 
 	switch(weapon_mode) {
 		case WEAPON_MODE::ATTRACT:
@@ -621,6 +636,7 @@ bool game::release_object(const WEAPON_MODE& weapon_mode) {
 		// make object visible
 		active_map->update_dynamic(body, selected_block_mat);
 	}
+	realBody->activate(true);
 	switch(weapon_mode) {
 		case WEAPON_MODE::FORCE: {
 			// force object to stop and add additional power
@@ -805,6 +821,117 @@ void game::damage(const float& value) {
 }
 
 bool game::is_in_line_of_sight(const float3& pos, const float& max_distance) const {
-	const static_intersection intersection = intersect_static(ray(pos, (get_position() - pos).normalized()));
-	return intersection.is_invalid() || (intersection.distance > max_distance);
+	const float3 player_pos(get_position());
+	const los_key key { uint3(pos.floored()), uint3(player_pos.floored()), max_distance };
+	
+	size_t generation = 0;
+	{
+		lock_guard<mutex> guard(los_cache_lock);
+		const auto entry = los_cache.find(key);
+		if(entry != los_cache.end()) {
+			los_cache_hits++;
+			return entry->second.visible;
+		}
+		los_cache_misses++;
+		generation = los_cache_generation;
+	}
+	
+	// note: the query will stop at max_distance or at the player (blocks behind the player don't occlude
+	// anything and would lie outside of the cached bbox)
+	const float3 player_dir(player_pos - pos);
+	const float query_distance = std::min(max_distance, player_dir.length());
+	const bool visible = query_ray(ray_query { ray(pos, player_dir.normalized()), RAY_CATEGORY::STATIC, query_distance }).is_invalid();
+	
+	lock_guard<mutex> guard(los_cache_lock);
+	if(generation != los_cache_generation) {
+		// something was evicted while the ray was being cast -> the result might already be stale
+		return visible;
+	}
+	if(los_cache.size() >= max_los_cache_entries && los_cache.count(key) == 0) {
+		// this should only happen with lots of ais -> simply start over
+		los_cache_evictions += los_cache.size();
+		los_cache.clear();
+		los_cache_generation++;
+	}
+	// the ray can only pass through blocks inside the bbox spanned by both blocks
+	los_cache[key] = los_entry {
+		visible,
+		uint3::min(key.ai_block, key.player_block),
+		uint3::max(key.ai_block, key.player_block)
+	};
+	return visible;
+}
+
+game::los_cache_stats game::get_los_cache_stats() const {
+	lock_guard<mutex> guard(los_cache_lock);
+	return los_cache_stats { los_cache_hits, los_cache_misses, los_cache_evictions, los_cache.size() };
+}
+
+void game::evict_los_entries(const function<bool(const los_key&, const los_entry&)>& predicate) {
+	los_cache_generation++;
+	for(auto iter = los_cache.begin(); iter != los_cache.end();) {
+		if(predicate(iter->first, iter->second)) {
+			iter = los_cache.erase(iter);
+			los_cache_evictions++;
+		}
+		else ++iter;
+	}
+}
+
+bool game::los_handler(EVENT_TYPE type, shared_ptr<event_object> obj) {
+	if(type == EVENT_TYPE::BLOCK_CHANGE) {
+		const uint3 position(((shared_ptr<block_change_event>&)obj)->position);
+		lock_guard<mutex> guard(los_cache_lock);
+		evict_los_entries([&position](const los_key&, const los_entry& entry) {
+			return ((position >= entry.bbox_min).all() && (position <= entry.bbox_max).all());
+		});
+		return true;
+	}
+	else if(type == EVENT_TYPE::PLAYER_BLOCK_STEP) {
+		// there is only one player -> all entries for other player blocks are stale
+		const uint3 player_block(get_position().floored());
+		lock_guard<mutex> guard(los_cache_lock);
+		evict_los_entries([&player_block](const los_key& key, const los_entry&) {
+			return (key.player_block != player_block).any();
+		});
+		return true;
+	}
+	else if(type == EVENT_TYPE::AI_BLOCK_STEP) {
+		const ai_entity* step_ai = ((shared_ptr<ai_block_step_event>&)obj)->ai;
+		const uint3 ai_block(step_ai->get_position().floored());
+		lock_guard<mutex> guard(los_cache_lock);
+		const auto prev_block = los_ai_blocks.find(step_ai);
+		if(prev_block != los_ai_blocks.end()) {
+			const uint3 old_block(prev_block->second);
+			if((old_block != ai_block).any()) {
+				evict_los_entries([&old_block](const los_key& key, const los_entry&) {
+					return (key.ai_block == old_block).all();
+				});
+			}
+		}
+		los_ai_blocks[step_ai] = ai_block;
+		return true;
+	}
+	else if(type == EVENT_TYPE::AI_DESTROY) {
+		// note: the ai is already gone (or about to be) -> only use it as a key
+		lock_guard<mutex> guard(los_cache_lock);
+		const auto ai_block = los_ai_blocks.find(((shared_ptr<ai_destroy_event>&)obj)->ai);
+		if(ai_block != los_ai_blocks.end()) {
+			const uint3 old_block(ai_block->second);
+			los_ai_blocks.erase(ai_block);
+			evict_los_entries([&old_block](const los_key& key, const los_entry&) {
+				return (key.ai_block == old_block).all();
+			});
+		}
+		return true;
+	}
+	else if(type == EVENT_TYPE::MAP_LOAD || type == EVENT_TYPE::MAP_UNLOAD) {
+		lock_guard<mutex> guard(los_cache_lock);
+		los_cache.clear();
+		los_cache_generation++;
+		los_ai_blocks.clear();
+		los_cache_hits = los_cache_misses = los_cache_evictions = 0;
+		return true;
+	}
+	return false;
 }
@@ -52,6 +52,15 @@ public:
 	virtual void damage(const float& value);
 	bool is_in_line_of_sight(const float3& pos, const float& max_distance) const;
 	
+	// line of sight cache statistics
+	struct los_cache_stats {
+		size_t hits;
+		size_t misses;
+		size_t evictions;
+		size_t entries;
+	};
+	los_cache_stats get_los_cache_stats() const;
+	
 protected:
 	enum class WEAPON_MODE {
 		FORCE,
@@ -86,6 +95,46 @@ protected:
 	event::handler action_handler_fct;
 	bool action_handler(EVENT_TYPE type, shared_ptr<event_object> obj);
 	
+	// line of sight cache: visibility is cached per (ai block, player block, max distance) and stays valid
+	// until either party steps onto another block or a block inside the ray bbox changes
+	// (the ray query is clamped to the player distance, so it never leaves this bbox)
+	struct los_key {
+		uint3 ai_block;
+		uint3 player_block;
+		float max_distance;
+		bool operator==(const los_key& key) const {
+			return ((ai_block == key.ai_block).all() && (player_block == key.player_block).all() &&
+					max_distance == key.max_distance);
+		}
+	};
+	struct los_key_hash {
+		size_t operator()(const los_key& key) const {
+			size_t hash = 0;
+			for(const auto& value : { key.ai_block.x, key.ai_block.y, key.ai_block.z,
+									  key.player_block.x, key.player_block.y, key.player_block.z }) {
+				hash = (hash * 31) ^ value;
+			}
+			return (hash * 31) ^ std::hash<float>()(key.max_distance);
+		}
+	};
+	struct los_entry {
+		bool visible;
+		uint3 bbox_min;
+		uint3 bbox_max;
+	};
+	static constexpr size_t max_los_cache_entries = 1024;
+	mutable mutex los_cache_lock;
+	mutable unordered_map<los_key, los_entry, los_key_hash> los_cache;
+	mutable size_t los_cache_hits = 0, los_cache_misses = 0, los_cache_evictions = 0;
+	// incremented by every eviction: a query result is only cached if no eviction happened while it was computed
+	mutable size_t los_cache_generation = 0;
+	unordered_map<const ai_entity*, uint3> los_ai_blocks;
+	// note: all of the above is guarded by los_cache_lock, which must be held when calling this
+	void evict_los_entries(const function<bool(const los_key&, const los_entry&)>& predicate);
+	
+	event::handler los_handler_fct;
+	bool los_handler(EVENT_TYPE type, shared_ptr<event_object> obj);
+	
 	// gui rendering
 	ui_draw_callback gui_callback;
 	gui_simple_callback* cb_obj = nullptr;
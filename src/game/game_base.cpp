@@ -20,10 +20,14 @@
 #include "block_textures.h"
 #include "builtin_models.h"
 #include "rigid_body.h"
+#include "physics_controller.h"
 #include "ai_entity.h"
+#include "game.h"
 #include <engine.h>
+#include <future>
 
 const unsigned int game_base::invalid_pos = (~0u);
+constexpr float game_base::max_selection_distance;
 
 game_base::game_base() {
 }
@@ -84,21 +88,7 @@ const matrix4f game_base::compute_block_view_matrix(const uint3& pos, const floa
 }
 
 game_base::dynamic_intersection game_base::intersect_dynamic() {
-	dynamic_intersection closest_block = { nullptr, BLOCK_MATERIAL::NONE, numeric_limits<float>::max() };
-	if(active_map == nullptr) return closest_block;
-	ray sel_line = compute_camera_scene_ray();
-	pair<float, float> ret;
-
-	for(const auto& dyn_body : active_map->get_dynamic_bodies()) {
-		bbox box;
-		dyn_body.first->compute_bbox(box);
-		box.intersect(ret, sel_line);
-		if(ret.first < ret.second && ret.first < closest_block.distance) {
-			// store closest hit
-			closest_block = dynamic_intersection(dyn_body.first, dyn_body.second, ret.first);
-		}
-	}
-	return closest_block;
+	return query_ray(ray_query { compute_camera_scene_ray(), RAY_CATEGORY::DYNAMIC, max_selection_distance }).dynamic_hit;
 }
 
 ray game_base::compute_scene_camera_ray() {
@@ -114,9 +104,33 @@ float3 game_base::compute_sceneinverse_projected_point(const float3& pos) {
 }
 
 ray game_base::compute_camera_scene_ray() {
-	const float3 proj_pos = compute_sceneinverse_projected_point(float3(0.0f, 0.0f, 1.0f));
+	// the inverse view-projection matrix only changes with the camera -> cache the ray direction
+	static mutex cache_lock;
+	static struct {
+		matrix4f rotation;
+		float fov = 0.0f;
+		float aspect_ratio = 0.0f;
+		float2 near_far_plane;
+		float3 direction;
+	} cache;
+	
+	const float fov = e->get_fov();
+	const float aspect_ratio = float(e->get_width()) / float(e->get_height());
+	const float2 near_far_plane(e->get_near_far_plane());
+	
+	lock_guard<mutex> guard(cache_lock);
+	if(cache.fov != fov || cache.aspect_ratio != aspect_ratio ||
+	   !(cache.near_far_plane == near_far_plane).all() ||
+	   memcmp(&cache.rotation, e->get_rotation_matrix(), sizeof(matrix4f)) != 0) {
+		cache.rotation = *e->get_rotation_matrix();
+		cache.fov = fov;
+		cache.aspect_ratio = aspect_ratio;
+		cache.near_far_plane = near_far_plane;
+		cache.direction = compute_sceneinverse_projected_point(float3(0.0f, 0.0f, 1.0f)).normalized();
+	}
+	
 	// create ray from camera to this point
-	return ray(-*e->get_position(), proj_pos.normalized());
+	return ray(-*e->get_position(), cache.direction);
 }
 
 game_base::static_intersection::static_intersection(const static_intersection& other)
@@ -168,80 +182,126 @@ bool game_base::dynamic_intersection::is_invalid() const {
 }
 
 game_base::static_intersection game_base::intersect_static() {
-	return intersect_static(compute_camera_scene_ray());
+	return query_ray(ray_query { compute_camera_scene_ray(), RAY_CATEGORY::STATIC, max_selection_distance }).static_hit;
 }
 
-game_base::static_intersection game_base::intersect_static(const ray& sel_line) {
+game_base::static_intersection game_base::intersect_static(const ray& sel_line, const float max_distance) {
 	if(active_map == nullptr) return static_intersection();
 	
-	// first: intersect all chunk boxes (so we know which to check and in what order)
-	vector<pair<float, unsigned int>> intersected_chunks;
-	pair<float, float> ret;
-	for(unsigned int chunk_index = 0, chunk_max_index = (unsigned int)active_map->get_chunks().size();
-		chunk_index < chunk_max_index; chunk_index++) {
-		const uint3 pos = active_map->chunk_index_to_position(chunk_index) * sb_map::chunk_extent;
-		const bbox chunk_bbox(pos, pos + uint3(sb_map::chunk_extent));
-		chunk_bbox.intersect(ret, sel_line);
-		if(ret.first < ret.second) {
-			intersected_chunks.emplace_back(ret.first, chunk_index);
+	// 3D-DDA voxel traversal (Amanatides/Woo): only visits the blocks that are actually crossed by the ray
+	const float3& origin(sel_line.origin);
+	const float3& dir(sel_line.direction);
+	const uint3 map_extent(active_map->get_chunk_count() * sb_map::chunk_extent);
+	
+	// clip the ray against the map bbox (and max distance)
+	float t_enter = 0.0f, t_exit = max_distance;
+	int enter_axis = -1; // -1: origin lies inside the map
+	for(int i = 0; i < 3; i++) {
+		if(dir[i] == 0.0f) {
+			if(origin[i] < 0.0f || origin[i] >= float(map_extent[i])) return static_intersection();
+			continue;
+		}
+		float t_min = -origin[i] / dir[i];
+		float t_max = (float(map_extent[i]) - origin[i]) / dir[i];
+		if(t_min > t_max) swap(t_min, t_max);
+		if(t_min > t_enter) {
+			t_enter = t_min;
+			enter_axis = i;
 		}
+		t_exit = std::min(t_exit, t_max);
 	}
-	if(intersected_chunks.empty()) return static_intersection();
-	
-	// sort by intersection distance
-	sort(begin(intersected_chunks), end(intersected_chunks),
-		 [](const decltype(intersected_chunks)::value_type& elem_0,
-			const decltype(intersected_chunks)::value_type& elem_1) {
-			 return (elem_0.first < elem_1.first);
-	});
+	if(t_enter > t_exit) return static_intersection();
 	
-	// second: intersect all blocks within a chunk (starting with the closest chunk)
-	pair<float, unsigned int> closest_block = { numeric_limits<float>::max(), 0 };
-	uint3 global_position(0, 0, 0);
-	for(const auto& chunk : intersected_chunks) {
-		global_position.set(active_map->chunk_index_to_position(chunk.second) * sb_map::chunk_extent);
-		closest_block = { numeric_limits<float>::max(), 0 };
-		vector<pair<float, unsigned int>> intersected_blocks;
-		for(unsigned int block_index = 0; block_index < sb_map::blocks_per_chunk; block_index++) {
-			if(active_map->get_block(chunk.second, block_index).material != BLOCK_MATERIAL::NONE) {
-				const uint3 pos = sb_map::block_index_to_position(block_index) + global_position;
-				const bbox block_bbox(pos, pos + uint3(1, 1, 1));
-				block_bbox.intersect(ret, sel_line);
-				if(ret.first < ret.second && ret.first >= 0.0f) {
-					intersected_blocks.emplace_back(ret.first, block_index);
-				}
-			}
+	// init traversal
+	const float3 start_pos(origin + dir * t_enter);
+	int3 voxel, step;
+	float3 t_next, t_delta;
+	for(int i = 0; i < 3; i++) {
+		voxel[i] = core::clamp((int)floorf(start_pos[i]), 0, (int)map_extent[i] - 1);
+		if(dir[i] > 0.0f) {
+			step[i] = 1;
+			t_next[i] = (float(voxel[i] + 1) - origin[i]) / dir[i];
+			t_delta[i] = 1.0f / dir[i];
 		}
-		if(!intersected_blocks.empty()) {
-			// we have a block intersection, find the closest one and break (since we know it's the closest one)
-			for_each(begin(intersected_blocks), end(intersected_blocks),
-					 [&closest_block](const decltype(intersected_blocks)::value_type& elem) {
-						 if(elem.first < closest_block.first) {
-							 closest_block = elem;
-						 }
-			});
-			break;
+		else if(dir[i] < 0.0f) {
+			step[i] = -1;
+			t_next[i] = (float(voxel[i]) - origin[i]) / dir[i];
+			t_delta[i] = -1.0f / dir[i];
+		}
+		else {
+			step[i] = 0;
+			t_next[i] = numeric_limits<float>::max();
+			t_delta[i] = numeric_limits<float>::max();
 		}
 	}
 	
-	static const float max_distance = sb_map::chunk_extent * 8; // 128.0f
-	if(closest_block.first > max_distance) return static_intersection();
-	
-	// check which block face is selected
-	const uint3 local_position = sb_map::block_index_to_position(closest_block.second);
-	const bbox intersection_bbox(local_position + global_position, local_position + global_position + uint3(1, 1, 1));
-	BLOCK_FACE face = BLOCK_FACE::INVALID;
-	const float3 intersection_pos = sel_line.origin + sel_line.direction * (closest_block.first); // add a small epsilon
-	if(FLOAT_EQ(intersection_pos.x, intersection_bbox.min.x)) face = BLOCK_FACE::LEFT;
-	else if(FLOAT_EQ(intersection_pos.x, intersection_bbox.max.x)) face = BLOCK_FACE::RIGHT;
-	else if(FLOAT_EQ(intersection_pos.y, intersection_bbox.min.y)) face = BLOCK_FACE::BOTTOM;
-	else if(FLOAT_EQ(intersection_pos.y, intersection_bbox.max.y)) face = BLOCK_FACE::TOP;
-	else if(FLOAT_EQ(intersection_pos.z, intersection_bbox.min.z)) face = BLOCK_FACE::FRONT;
-	else if(FLOAT_EQ(intersection_pos.z, intersection_bbox.max.z)) face = BLOCK_FACE::BACK;
+	// the entered face is solely defined by the step axis and direction
+	static const array<BLOCK_FACE, 6> faces {
+		{
+			BLOCK_FACE::RIGHT, BLOCK_FACE::LEFT, // x: -1, +1
+			BLOCK_FACE::TOP, BLOCK_FACE::BOTTOM, // y: -1, +1
+			BLOCK_FACE::BACK, BLOCK_FACE::FRONT, // z: -1, +1
+		}
+	};
 	
-	const uint3 block_ref_pos(local_position + global_position);
-	const sb_map::block_data& block_ref_data = active_map->get_block(block_ref_pos);
-	return static_intersection(make_pair(block_ref_pos, face), block_ref_data.material, closest_block.first);
+	float t = t_enter;
+	int axis = enter_axis;
+	unsigned int cur_chunk_index = ~0u;
+	bool cur_chunk_empty = true;
+	// note: the block containing the ray origin is never selected
+	for(bool check_voxel = (enter_axis != -1); t <= t_exit; check_voxel = true) {
+		if(check_voxel) {
+			// skip empty chunks as a whole (no block lookups or per-block steps necessary)
+			const uint3 global_pos(voxel.x, voxel.y, voxel.z);
+			const unsigned int chunk_index = active_map->chunk_position_to_index(global_pos / sb_map::chunk_extent);
+			if(chunk_index != cur_chunk_index) {
+				cur_chunk_index = chunk_index;
+				cur_chunk_empty = (active_map->get_chunk_block_count(chunk_index) == 0);
+			}
+			if(cur_chunk_empty) {
+				// advance straight to the ray exit of this chunk and restart the traversal there
+				const int chunk_extent = (int)sb_map::chunk_extent;
+				int3 chunk_min, chunk_max;
+				float t_chunk_exit = numeric_limits<float>::max();
+				for(int i = 0; i < 3; i++) {
+					chunk_min[i] = (voxel[i] / chunk_extent) * chunk_extent;
+					chunk_max[i] = chunk_min[i] + chunk_extent;
+					if(step[i] == 0) continue;
+					const float t_bound = (float(step[i] > 0 ? chunk_max[i] : chunk_min[i]) - origin[i]) / dir[i];
+					if(t_bound < t_chunk_exit) {
+						t_chunk_exit = t_bound;
+						axis = i;
+					}
+				}
+				if(t_chunk_exit > t_exit) break;
+				
+				t = t_chunk_exit;
+				const float3 exit_pos(origin + dir * t);
+				for(int i = 0; i < 3; i++) {
+					if(i == axis) voxel[i] = (step[i] > 0 ? chunk_max[i] : chunk_min[i] - 1);
+					else voxel[i] = core::clamp((int)floorf(exit_pos[i]), chunk_min[i], chunk_max[i] - 1);
+					if(step[i] > 0) t_next[i] = (float(voxel[i] + 1) - origin[i]) / dir[i];
+					else if(step[i] < 0) t_next[i] = (float(voxel[i]) - origin[i]) / dir[i];
+				}
+				if(voxel[axis] < 0 || voxel[axis] >= (int)map_extent[axis]) break;
+				continue;
+			}
+			
+			const BLOCK_MATERIAL mat = active_map->get_block(chunk_index, sb_map::block_position_to_index(global_pos % sb_map::chunk_extent)).material;
+			if(mat != BLOCK_MATERIAL::NONE) {
+				return static_intersection(make_pair(global_pos, faces[(size_t)axis * 2 + (step[axis] > 0 ? 1 : 0)]), mat, t);
+			}
+		}
+		
+		// step to the next voxel
+		if(t_next.x < t_next.y) axis = (t_next.x < t_next.z ? 0 : 2);
+		else axis = (t_next.y < t_next.z ? 1 : 2);
+		t = t_next[axis];
+		t_next[axis] += t_delta[axis];
+		voxel[axis] += step[axis];
+		if(voxel[axis] < 0 || voxel[axis] >= (int)map_extent[axis]) break;
+	}
+	return static_intersection();
 }
 
 game_base::ai_intersection::ai_intersection(const ai_intersection& other)
@@ -264,19 +324,98 @@ bool game_base::ai_intersection::is_invalid() const {
 }
 
 game_base::ai_intersection game_base::intersect_ai() {
-	ai_intersection closest_ai;
-	if(active_map == nullptr) return closest_ai;
-	ray sel_line = compute_camera_scene_ray();
-	pair<float, float> ret;
-	for(const auto& ai : active_map->get_ai_entities()) {
-		rigid_body* ai_body = ai->get_character_body();
-		bbox box;
-		ai_body->compute_bbox(box);
-		box.intersect(ret, sel_line);
-		if(ret.first < ret.second && ret.first < closest_ai.distance) {
-			// store closest hit
-			closest_ai = ai_intersection(ai, ret.first);
+	return query_ray(ray_query { compute_camera_scene_ray(), RAY_CATEGORY::AI, max_selection_distance }).ai_hit;
+}
+
+bool game_base::ray_query_result::is_invalid() const {
+	return (category == RAY_CATEGORY::NONE);
+}
+
+float game_base::ray_query_result::get_distance() const {
+	switch(category) {
+		case RAY_CATEGORY::STATIC: return static_hit.distance;
+		case RAY_CATEGORY::DYNAMIC: return dynamic_hit.distance;
+		case RAY_CATEGORY::AI: return ai_hit.distance;
+		default: break;
+	}
+	return numeric_limits<float>::max();
+}
+
+game_base::ray_query_result game_base::query_ray(const ray_query& query) {
+	vector<ray_query_result> results;
+	query_rays(vector<ray_query> { query }, results);
+	return results[0];
+}
+
+void game_base::query_rays(const vector<ray_query>& queries, vector<ray_query_result>& results, const bool parallel) {
+	results.clear();
+	results.resize(queries.size(), ray_query_result {
+		RAY_CATEGORY::NONE, static_intersection(), dynamic_intersection(), ai_intersection()
+	});
+	if(active_map == nullptr || queries.empty()) return;
+	
+	const auto has_category = [](const ray_query& query, const RAY_CATEGORY& category) {
+		return (((unsigned int)query.categories & (unsigned int)category) != 0);
+	};
+	
+	// first pass: static voxels (this doesn't require any physics lock, so it can be done in parallel)
+	const auto static_pass = [&queries, &results, &has_category](const size_t begin_idx, const size_t end_idx) {
+		for(size_t i = begin_idx; i < end_idx; i++) {
+			if(!has_category(queries[i], RAY_CATEGORY::STATIC)) continue;
+			results[i].static_hit = intersect_static(queries[i].sel_line, queries[i].max_distance);
+			if(!results[i].static_hit.is_invalid()) results[i].category = RAY_CATEGORY::STATIC;
+		}
+	};
+	const size_t thread_count = std::min(size_t(thread::hardware_concurrency()), queries.size());
+	if(parallel && thread_count > 1) {
+		vector<future<void>> tasks;
+		const size_t queries_per_thread = (queries.size() + thread_count - 1) / thread_count;
+		for(size_t begin_idx = 0; begin_idx < queries.size(); begin_idx += queries_per_thread) {
+			tasks.emplace_back(async(launch::async, static_pass, begin_idx, std::min(begin_idx + queries_per_thread, queries.size())));
+		}
+		for(auto& task : tasks) task.get();
+	}
+	else static_pass(0, queries.size());
+	
+	// second pass: dynamic bodies and ai (one broadphase ray test per ray, stopping at the static hit)
+	// note: static-only queries must not take the physics lock, since they are also issued from the
+	// physics think workers while the physics thread holds it
+	const bool needs_physics = any_of(begin(queries), end(queries), [&has_category](const ray_query& query) {
+		return (has_category(query, RAY_CATEGORY::DYNAMIC) || has_category(query, RAY_CATEGORY::AI));
+	});
+	if(!needs_physics) return;
+	
+	rigid_body* player_body = (ge != nullptr ? ge->get_character_body() : nullptr);
+	const auto& dynamic_bodies(active_map->get_dynamic_bodies());
+	pc->lock();
+	for(size_t i = 0; i < queries.size(); i++) {
+		const ray_query& query(queries[i]);
+		short int mask = 0;
+		if(has_category(query, RAY_CATEGORY::DYNAMIC)) mask |= physics_controller::collision_group_blocks;
+		if(has_category(query, RAY_CATEGORY::AI)) mask |= physics_controller::collision_group_characters;
+		if(mask == 0) continue;
+		
+		// note: the player body is ignored, since camera rays start inside it
+		const float max_distance = std::min(query.max_distance, results[i].get_distance());
+		const physics_controller::ray_hit hit = pc->ray_test(query.sel_line.origin,
+															 query.sel_line.origin + query.sel_line.direction * max_distance,
+															 mask, player_body);
+		if(hit.body == nullptr) continue;
+		
+		const float distance = hit.fraction * max_distance;
+		const auto dyn_body = dynamic_bodies.find(hit.body);
+		if(dyn_body != dynamic_bodies.end()) {
+			results[i].dynamic_hit = dynamic_intersection(dyn_body->first, dyn_body->second, distance);
+			results[i].category = RAY_CATEGORY::DYNAMIC;
+			continue;
+		}
+		for(const auto& ai : active_map->get_ai_entities()) {
+			if(ai->get_character_body() == hit.body) {
+				results[i].ai_hit = ai_intersection(ai, distance);
+				results[i].category = RAY_CATEGORY::AI;
+				break;
+			}
 		}
 	}
-	return closest_ai;
+	pc->unlock();
 }
@@ -59,8 +59,9 @@ protected:
 		static_intersection(const pair<uint3, BLOCK_FACE>& block_ref, BLOCK_MATERIAL material, float distance);
 		static_intersection(const static_intersection& other);
 	};
+	static constexpr float max_selection_distance = sb_map::chunk_extent * 8; // 128.0f
 	static static_intersection intersect_static();
-	static static_intersection intersect_static(const ray& sel_line);
+	static static_intersection intersect_static(const ray& sel_line, const float max_distance = max_selection_distance);
 
 	struct dynamic_intersection {
 		rigid_body* body;
@@ -86,6 +87,33 @@ protected:
 		ai_intersection(ai_entity* ai, float distance);
 	};
 	static ai_intersection intersect_ai();
+	
+	// unified ray queries: each ray is tested against all requested categories in one pass and only the
+	// nearest hit is returned (note: the physics lock is only taken once per batch)
+	enum class RAY_CATEGORY : unsigned int {
+		NONE	= 0,
+		STATIC	= (1 << 0),
+		DYNAMIC	= (1 << 1),
+		AI		= (1 << 2),
+		ALL		= (STATIC | DYNAMIC | AI)
+	};
+	struct ray_query {
+		ray sel_line;
+		RAY_CATEGORY categories;
+		float max_distance;
+	};
+	struct ray_query_result {
+		RAY_CATEGORY category; // category of the nearest hit (NONE if nothing was hit)
+		static_intersection static_hit;
+		dynamic_intersection dynamic_hit;
+		ai_intersection ai_hit;
+		
+		bool is_invalid() const;
+		float get_distance() const;
+	};
+	static ray_query_result query_ray(const ray_query& query);
+	// if parallel is set, the static part of the queries will be distributed over multiple threads
+	static void query_rays(const vector<ray_query>& queries, vector<ray_query_result>& results, const bool parallel = false);
 
 	static const matrix4f compute_block_view_matrix(const uint3& pos, const float scale = 0.05f);
 
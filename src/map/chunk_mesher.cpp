@@ -0,0 +1,362 @@
+/*
+ *  Blocks In Motion
+ *  Copyright (C) 2012 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "chunk_mesher.h"
+#include "sb_map.h"
+#include "builtin_models.h"
+
+// the 6 faces in the order of the builtin cube model (bottom, top, front, right, back, left):
+// direction toward the neighboring block and the axis along which the face is oriented
+static const array<int3, 6> face_directions {
+	{
+		int3(0, -1, 0), int3(0, 1, 0), int3(0, 0, -1), int3(1, 0, 0), int3(0, 0, 1), int3(-1, 0, 0),
+	}
+};
+// <normal axis, first tangential axis, second tangential axis> (0 = x, 1 = y, 2 = z)
+static const array<array<unsigned int, 3>, 6> face_axes {
+	{
+		{ { 1, 0, 2 } }, { { 1, 0, 2 } }, { { 2, 0, 1 } }, { { 0, 2, 1 } }, { { 2, 0, 1 } }, { { 0, 2, 1 } },
+	}
+};
+
+chunk_mesher::chunk_mesher() : thread_base("chunk_mesher"),
+evt_handler_fnctr(this, &chunk_mesher::event_handler) {
+	eevt->add_event_handler(evt_handler_fnctr, EVENT_TYPE::BLOCK_CHANGE);
+	this->set_thread_delay(20);
+	this->start();
+}
+
+chunk_mesher::~chunk_mesher() {
+	eevt->remove_event_handler(evt_handler_fnctr);
+	this->finish();
+	delete_chunk_meshes();
+}
+
+void chunk_mesher::rebuild(const sb_map& map) {
+	const uint3 map_chunk_count(map.get_chunk_count());
+	const uint3 map_extent(map_chunk_count * sb_map::chunk_extent);
+	vector<unsigned short> new_cells(map_extent.x * map_extent.y * map_extent.z, 0);
+	const auto& chunks(map.get_chunks());
+	for(unsigned int chunk_index = 0, count = (unsigned int)chunks.size(); chunk_index < count; chunk_index++) {
+		if(map.get_chunk_block_count(chunk_index) == 0) continue;
+		const uint3 chunk_origin(map.chunk_index_to_position(chunk_index) * sb_map::chunk_extent);
+		for(unsigned int block_index = 0; block_index < sb_map::blocks_per_chunk; block_index++) {
+			const uint3 pos(chunk_origin + sb_map::block_index_to_position(block_index));
+			new_cells[(pos.y * map_extent.z + pos.z) * map_extent.x + pos.x] =
+				(unsigned short)sb_map::block_render_material(chunks[chunk_index][block_index].material);
+		}
+	}
+	
+	lock_guard<mutex> guard(data_lock);
+	pending_cells.swap(new_cells);
+	pending_chunk_count = map_chunk_count;
+	has_pending_cells = true;
+	pending_generation++;
+	pending_changes.clear();
+	finished_meshes.clear();
+}
+
+bool chunk_mesher::is_empty(const int3& pos) const {
+	// everything outside of the map is considered solid, so that all outer faces are culled
+	if(pos.x < 0 || pos.y < 0 || pos.z < 0 ||
+	   pos.x >= extent.x || pos.y >= extent.y || pos.z >= extent.z) {
+		return false;
+	}
+	return (cells[size_t((pos.y * extent.z + pos.z) * extent.x + pos.x)] == 0);
+}
+
+void chunk_mesher::mark_dirty(const uint3& pos) {
+	// a changed block also affects the faces of its neighbors, which may be part of a neighboring chunk
+	const int extent_i(sb_map::chunk_extent);
+	const int3 chunk_pos(int3(pos) / extent_i);
+	const int3 local_pos(int3(pos) - chunk_pos * extent_i);
+	for(int y = (local_pos.y == 0 ? -1 : 0); y <= (local_pos.y == extent_i - 1 ? 1 : 0); y++) {
+		for(int z = (local_pos.z == 0 ? -1 : 0); z <= (local_pos.z == extent_i - 1 ? 1 : 0); z++) {
+			for(int x = (local_pos.x == 0 ? -1 : 0); x <= (local_pos.x == extent_i - 1 ? 1 : 0); x++) {
+				// only direct (face) neighbors share faces
+				if(abs(x) + abs(y) + abs(z) > 1) continue;
+				const int3 neighbor_chunk(chunk_pos + int3(x, y, z));
+				if(neighbor_chunk.x < 0 || neighbor_chunk.y < 0 || neighbor_chunk.z < 0 ||
+				   neighbor_chunk.x >= (int)chunk_count.x || neighbor_chunk.y >= (int)chunk_count.y ||
+				   neighbor_chunk.z >= (int)chunk_count.z) {
+					continue;
+				}
+				dirty_chunks[(neighbor_chunk.y * chunk_count.z + neighbor_chunk.z) * chunk_count.x + neighbor_chunk.x] = true;
+			}
+		}
+	}
+}
+
+void chunk_mesher::add_quad(mesh_data& mesh, const unsigned int& face, const float3& origin,
+							const float3& size, const unsigned int& material) {
+	// the quad is the cube face scaled to the merged size, the texture coordinates are extended
+	// accordingly (textures repeat, so every block still covers exactly one texture)
+	const size_t first_vertex(face * 4);
+	const float3& v0(builtin_models::cube_vertices[first_vertex]);
+	const float3 edge_01(builtin_models::cube_vertices[first_vertex + 1] - v0);
+	const float3 edge_03(builtin_models::cube_vertices[first_vertex + 3] - v0);
+	const float2 tc0(builtin_models::cube_tex_coords[first_vertex]);
+	const float2 tc_01(float2(builtin_models::cube_tex_coords[first_vertex + 1]) - tc0);
+	const float2 tc_03(float2(builtin_models::cube_tex_coords[first_vertex + 3]) - tc0);
+	
+	// flipped materials are mirrored horizontally on every other y layer (quads never span multiple
+	// y layers in this case, see build_mesh)
+	const bool flip((material & sb_map::render_flip_flag) != 0 &&
+					(((unsigned int)origin.y) % 2) == 1);
+	
+	const unsigned int base_index((unsigned int)mesh.vertices.size());
+	for(size_t i = 0; i < 4; i++) {
+		const float3& vertex(builtin_models::cube_vertices[first_vertex + i]);
+		const float3 scaled_vertex(vertex.x * size.x, vertex.y * size.y, vertex.z * size.z);
+		const float3 rel_vertex(scaled_vertex - float3(v0.x * size.x, v0.y * size.y, v0.z * size.z));
+		float2 tex_coord(tc0 + tc_01 * rel_vertex.dot(edge_01) + tc_03 * rel_vertex.dot(edge_03));
+		if(flip) tex_coord.x = 1.0f - tex_coord.x;
+		
+		mesh.vertices.push_back(origin + scaled_vertex);
+		mesh.tex_coords.push_back(tex_coord);
+		mesh.normals.push_back(builtin_models::cube_normals[first_vertex + i]);
+		mesh.binormals.push_back(builtin_models::cube_binormals[first_vertex + i]);
+		mesh.tangents.push_back(builtin_models::cube_tangents[first_vertex + i]);
+		mesh.materials.push_back(float(material & ~sb_map::render_flip_flag));
+	}
+	for(size_t i = 0; i < 2; i++) {
+		const uchar3& tri(builtin_models::cube_indices[face * 2 + i]);
+		mesh.indices.push_back(base_index + tri.x - (unsigned int)first_vertex);
+		mesh.indices.push_back(base_index + tri.y - (unsigned int)first_vertex);
+		mesh.indices.push_back(base_index + tri.z - (unsigned int)first_vertex);
+	}
+}
+
+void chunk_mesher::build_mesh(const unsigned int& chunk_index, mesh_data& mesh) const {
+	static constexpr int extent_i(sb_map::chunk_extent);
+	const int3 chunk_origin(int(chunk_index % chunk_count.x),
+							int(chunk_index / (chunk_count.x * chunk_count.z)),
+							int((chunk_index / chunk_count.x) % chunk_count.z));
+	const int3 block_origin(chunk_origin * extent_i);
+	mesh.chunk_index = chunk_index;
+	
+	array<unsigned int, sb_map::chunk_extent * sb_map::chunk_extent> mask;
+	array<int, 3> coords;
+	for(unsigned int face = 0; face < 6; face++) {
+		const auto& axes(face_axes[face]);
+		const int3& direction(face_directions[face]);
+		const bool side_face(axes[0] != 1);
+		for(int slice = 0; slice < extent_i; slice++) {
+			coords[axes[0]] = slice;
+			
+			// collect the visible faces of this slice (key: render material, 0 if there is no face)
+			bool any_face = false;
+			for(int b = 0; b < extent_i; b++) {
+				coords[axes[2]] = b;
+				for(int a = 0; a < extent_i; a++) {
+					coords[axes[1]] = a;
+					const int3 pos(block_origin + int3(coords[0], coords[1], coords[2]));
+					unsigned int key = cells[size_t((pos.y * extent.z + pos.z) * extent.x + pos.x)];
+					if(key != 0 && is_empty(pos + direction)) {
+						// side faces of flipped materials alternate every y layer -> must not be merged vertically
+						if(side_face && (key & sb_map::render_flip_flag) != 0) {
+							key |= ((unsigned int)coords[1] & 1u) << 16u;
+						}
+						any_face = true;
+					}
+					else key = 0;
+					mask[size_t(b * extent_i + a)] = key;
+				}
+			}
+			if(!any_face) continue;
+			
+			// greedily merge faces: extend each face as far as possible along the first axis,
+			// then extend the whole row along the second axis
+			for(int b = 0; b < extent_i; b++) {
+				for(int a = 0; a < extent_i;) {
+					const unsigned int key = mask[size_t(b * extent_i + a)];
+					if(key == 0) {
+						a++;
+						continue;
+					}
+					
+					int width = 1;
+					while(a + width < extent_i && mask[size_t(b * extent_i + a + width)] == key) width++;
+					int height = 1;
+					for(; b + height < extent_i; height++) {
+						bool row_match = true;
+						for(int i = 0; i < width; i++) {
+							if(mask[size_t((b + height) * extent_i + a + i)] != key) {
+								row_match = false;
+								break;
+							}
+						}
+						if(!row_match) break;
+					}
+					for(int j = 0; j < height; j++) {
+						for(int i = 0; i < width; i++) {
+							mask[size_t((b + j) * extent_i + a + i)] = 0;
+						}
+					}
+					
+					array<int, 3> quad_origin, quad_size;
+					quad_origin[axes[0]] = slice;
+					quad_origin[axes[1]] = a;
+					quad_origin[axes[2]] = b;
+					quad_size[axes[0]] = 1;
+					quad_size[axes[1]] = width;
+					quad_size[axes[2]] = height;
+					add_quad(mesh, face,
+							 float3(quad_origin[0], quad_origin[1], quad_origin[2]),
+							 float3(quad_size[0], quad_size[1], quad_size[2]),
+							 key & 0xFFFFu);
+					a += width;
+				}
+			}
+		}
+	}
+}
+
+void chunk_mesher::run() {
+	vector<unsigned int> build_list;
+	unsigned int build_generation;
+	uint3 build_chunk_count;
+	{
+		lock_guard<mutex> guard(data_lock);
+		if(has_pending_cells) {
+			// complete rebuild -> all chunks must be remeshed
+			cells.swap(pending_cells);
+			pending_cells.clear();
+			chunk_count = pending_chunk_count;
+			extent = int3(chunk_count * sb_map::chunk_extent);
+			generation = pending_generation;
+			has_pending_cells = false;
+			dirty_chunks.assign(chunk_count.x * chunk_count.y * chunk_count.z, true);
+		}
+		
+		for(const auto& change : pending_changes) {
+			const uint3& pos(change.first);
+			if(pos.x >= (unsigned int)extent.x || pos.y >= (unsigned int)extent.y || pos.z >= (unsigned int)extent.z) continue;
+			unsigned short& cell(cells[(pos.y * extent.z + pos.z) * extent.x + pos.x]);
+			if(cell == change.second) continue;
+			cell = change.second;
+			mark_dirty(pos);
+		}
+		pending_changes.clear();
+		
+		for(unsigned int chunk_index = 0, count = (unsigned int)dirty_chunks.size(); chunk_index < count; chunk_index++) {
+			if(!dirty_chunks[chunk_index]) continue;
+			dirty_chunks[chunk_index] = false;
+			build_list.push_back(chunk_index);
+		}
+		build_generation = generation;
+		build_chunk_count = chunk_count;
+	}
+	if(build_list.empty()) return;
+	
+	// note: cells are only modified by this thread, so no lock is needed while building
+	vector<mesh_data> meshes(build_list.size());
+	for(size_t i = 0, count = build_list.size(); i < count; i++) {
+		build_mesh(build_list[i], meshes[i]);
+	}
+	
+	lock_guard<mutex> guard(data_lock);
+	if(pending_generation != build_generation) return; // map was rebuilt in the meantime -> discard
+	if(finished_generation != build_generation) {
+		finished_meshes.clear();
+		finished_generation = build_generation;
+		finished_chunk_count = build_chunk_count;
+	}
+	for(auto& mesh : meshes) {
+		finished_meshes.emplace_back(move(mesh));
+	}
+}
+
+bool chunk_mesher::upload() {
+	vector<mesh_data> meshes;
+	unsigned int meshes_generation;
+	uint3 meshes_chunk_count;
+	{
+		lock_guard<mutex> guard(data_lock);
+		meshes.swap(finished_meshes);
+		meshes_generation = finished_generation;
+		meshes_chunk_count = finished_chunk_count;
+	}
+	
+	if(meshes_generation != uploaded_generation) {
+		// new map data -> all old meshes are invalid
+		delete_chunk_meshes();
+		chunk_meshes.resize(meshes_chunk_count.x * meshes_chunk_count.y * meshes_chunk_count.z);
+		for(size_t chunk_index = 0, count = chunk_meshes.size(); chunk_index < count; chunk_index++) {
+			chunk_meshes[chunk_index].offset = float3(chunk_index % meshes_chunk_count.x,
+													  chunk_index / (meshes_chunk_count.x * meshes_chunk_count.z),
+													  (chunk_index / meshes_chunk_count.x) % meshes_chunk_count.z) * float(sb_map::chunk_extent);
+		}
+		uploaded_generation = meshes_generation;
+	}
+	
+	const auto upload_buffer = [](GLuint& buffer, const GLenum target, const void* data, const size_t size) {
+		if(buffer == 0) glGenBuffers(1, &buffer);
+		glBindBuffer(target, buffer);
+		glBufferData(target, (GLsizeiptr)size, data, GL_STATIC_DRAW);
+	};
+	for(const auto& mesh : meshes) {
+		chunk_mesh& cmesh(chunk_meshes[mesh.chunk_index]);
+		if(!cmesh.valid) {
+			cmesh.valid = true;
+			valid_mesh_count++;
+		}
+		cmesh.index_count = mesh.indices.size();
+		if(mesh.indices.empty()) continue;
+		
+		upload_buffer(cmesh.vertices_vbo, GL_ARRAY_BUFFER, &mesh.vertices[0], mesh.vertices.size() * sizeof(float3));
+		upload_buffer(cmesh.tex_coords_vbo, GL_ARRAY_BUFFER, &mesh.tex_coords[0], mesh.tex_coords.size() * sizeof(coord));
+		upload_buffer(cmesh.normals_vbo, GL_ARRAY_BUFFER, &mesh.normals[0], mesh.normals.size() * sizeof(float3));
+		upload_buffer(cmesh.binormals_vbo, GL_ARRAY_BUFFER, &mesh.binormals[0], mesh.binormals.size() * sizeof(float3));
+		upload_buffer(cmesh.tangents_vbo, GL_ARRAY_BUFFER, &mesh.tangents[0], mesh.tangents.size() * sizeof(float3));
+		upload_buffer(cmesh.materials_vbo, GL_ARRAY_BUFFER, &mesh.materials[0], mesh.materials.size() * sizeof(float));
+		upload_buffer(cmesh.indices_vbo, GL_ELEMENT_ARRAY_BUFFER, &mesh.indices[0], mesh.indices.size() * sizeof(unsigned int));
+	}
+	if(!meshes.empty()) {
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	
+	return (!chunk_meshes.empty() && valid_mesh_count == chunk_meshes.size());
+}
+
+void chunk_mesher::delete_chunk_meshes() {
+	for(const auto& cmesh : chunk_meshes) {
+		for(const GLuint& buffer : { cmesh.vertices_vbo, cmesh.tex_coords_vbo, cmesh.normals_vbo, cmesh.binormals_vbo,
+									 cmesh.tangents_vbo, cmesh.materials_vbo, cmesh.indices_vbo }) {
+			if(buffer != 0 && glIsBuffer(buffer)) glDeleteBuffers(1, &buffer);
+		}
+	}
+	chunk_meshes.clear();
+	valid_mesh_count = 0;
+}
+
+const vector<chunk_mesher::chunk_mesh>& chunk_mesher::get_chunk_meshes() const {
+	return chunk_meshes;
+}
+
+bool chunk_mesher::event_handler(EVENT_TYPE type, shared_ptr<event_object> obj) {
+	if(type == EVENT_TYPE::BLOCK_CHANGE) {
+		const shared_ptr<block_change_event>& change_evt = (shared_ptr<block_change_event>&)obj;
+		lock_guard<mutex> guard(data_lock);
+		pending_changes.emplace_back(change_evt->position, (unsigned short)sb_map::block_render_material(change_evt->new_material));
+		return true;
+	}
+	return false;
+}
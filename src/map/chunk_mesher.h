@@ -0,0 +1,107 @@
+/*
+ *  Blocks In Motion
+ *  Copyright (C) 2012 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SB_CHUNK_MESHER_H__
+#define __SB_CHUNK_MESHER_H__
+
+#include "sb_global.h"
+#include <threading/thread_base.h>
+#include <gui/event.h>
+
+// builds a mesh of all visible block faces for each chunk, in which neighboring faces with the same
+// material and orientation are greedily merged into larger quads. meshes are built on a separate thread
+// (a complete rebuild after the map has been resized, incrementally for the chunks touched by
+// BLOCK_CHANGE events), the render thread only uploads finished meshes.
+class sb_map;
+class chunk_mesher : public thread_base {
+public:
+	chunk_mesher();
+	virtual ~chunk_mesher();
+	
+	virtual void run();
+	
+	// must be called after the map has been resized (copies all block data)
+	void rebuild(const sb_map& map);
+	
+	// uploads all finished meshes, returns true if there is a mesh for every chunk of the current map
+	// note: must be called from the render thread
+	bool upload();
+	
+	struct chunk_mesh {
+		float3 offset;
+		GLuint vertices_vbo = 0;
+		GLuint tex_coords_vbo = 0;
+		GLuint normals_vbo = 0;
+		GLuint binormals_vbo = 0;
+		GLuint tangents_vbo = 0;
+		GLuint materials_vbo = 0;
+		GLuint indices_vbo = 0;
+		size_t index_count = 0;
+		bool valid = false;
+	};
+	const vector<chunk_mesh>& get_chunk_meshes() const;
+	
+protected:
+	struct mesh_data {
+		unsigned int chunk_index;
+		vector<float3> vertices;
+		vector<coord> tex_coords;
+		vector<float3> normals;
+		vector<float3> binormals;
+		vector<float3> tangents;
+		vector<float> materials;
+		vector<unsigned int> indices;
+	};
+	
+	// all of this is only accessed by the mesher thread
+	// (cells contain the block render material, see sb_map::block_render_material, 0 if empty)
+	vector<unsigned short> cells;
+	uint3 chunk_count;
+	int3 extent;
+	vector<bool> dirty_chunks;
+	unsigned int generation = 0;
+	bool is_empty(const int3& pos) const;
+	void mark_dirty(const uint3& pos);
+	void build_mesh(const unsigned int& chunk_index, mesh_data& mesh) const;
+	static void add_quad(mesh_data& mesh, const unsigned int& face, const float3& origin,
+						 const float3& size, const unsigned int& material);
+	
+	// shared data (guarded by data_lock)
+	mutex data_lock;
+	vector<pair<uint3, unsigned short>> pending_changes;
+	vector<unsigned short> pending_cells;
+	uint3 pending_chunk_count;
+	bool has_pending_cells = false;
+	unsigned int pending_generation = 0;
+	vector<mesh_data> finished_meshes;
+	unsigned int finished_generation = 0; // generation of all meshes in finished_meshes
+	uint3 finished_chunk_count;
+	
+	// only accessed by the render thread
+	vector<chunk_mesh> chunk_meshes;
+	unsigned int uploaded_generation = 0;
+	size_t valid_mesh_count = 0;
+	void delete_chunk_meshes();
+	
+	event::handler evt_handler_fnctr;
+	bool event_handler(EVENT_TYPE type, shared_ptr<event_object> obj);
+	
+};
+
+#endif
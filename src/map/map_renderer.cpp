@@ -20,8 +20,10 @@
 #include "map_renderer.h"
 #include "block_textures.h"
 #include "builtin_models.h"
-#include "weight_slider.h"
 #include "game_base.h"
+#include "game.h"
+#include "ai_entity.h"
+#include "chunk_mesher.h"
 #include <scene/camera.h>
 #include <core/quaternion.h>
 #include <particle/particle.h>
@@ -90,6 +92,7 @@ map_event_handler_fctr(this, &map_renderer::map_event_handler)
 map_renderer::~map_renderer() {
 	eevt->remove_event_handler(map_event_handler_fctr);
 	sce->delete_model(this);
+	if(indirect_buffer != 0 && glIsBuffer(indirect_buffer)) glDeleteBuffers(1, &indirect_buffer);
 	
 	//
 	delete push_button;
@@ -108,6 +111,13 @@ map_renderer::~map_renderer() {
 		t->delete_texture(tex.second);
 	}
 	
+	for(const auto& emdl : entity_models) {
+		delete emdl.second->model;
+		delete emdl.second->material;
+		delete emdl.second;
+	}
+	entity_models.clear();
+	
 	if(glIsBuffer(draw_culling_vbo)) {
 		glDeleteBuffers(1, &draw_culling_vbo);
 	}
@@ -119,6 +129,58 @@ a2e_texture map_renderer::get_particle_texture(const string& name) {
 	return iter->second;
 }
 
+entity_model* map_renderer::get_entity_model(const string& model_filename, const string& material_filename, const float3& scale) {
+	const string key(model_filename + "|" + material_filename + "|" +
+					 float2string(scale.x) + "," + float2string(scale.y) + "," + float2string(scale.z));
+	const auto iter = entity_models.find(key);
+	if(iter != entity_models.end()) return iter->second;
+	
+	entity_model* emdl = new entity_model { sce->create_a2emodel<a2estatic>(), new a2ematerial(e) };
+	emdl->material->load_material(e->data_path(material_filename));
+	emdl->model->load_model(e->data_path(model_filename));
+	emdl->model->set_material(emdl->material);
+	emdl->model->set_hard_scale(scale.x, scale.y, scale.z);
+	// note: this is not added to the scene, but drawn for each entity in draw_entities
+	entity_models.insert(make_pair(key, emdl));
+	return emdl;
+}
+
+void map_renderer::draw_entities(const DRAW_MODE draw_mode) {
+	for(const auto& emdl : entity_models) {
+		emdl.second->model->set_ir_buffers(g_buffer, l_buffer,
+										   g_buffer_alpha, l_buffer_alpha);
+	}
+	
+	const auto draw_entity = [&draw_mode](const physics_entity* entity) {
+		if(!entity->is_visible()) return;
+		a2estatic* model = entity->get_model()->model;
+		model->set_position(entity->get_position());
+		model->set_rotation(entity->get_rotation());
+		model->draw(draw_mode);
+	};
+	if(ge != nullptr) draw_entity(ge);
+	for(const auto& ai : active_map->get_ai_entities()) {
+		draw_entity(ai);
+	}
+}
+
+particle_system* map_renderer::acquire_attack_effect() {
+	lock_guard<mutex> guard(attack_effects_lock);
+	if(free_attack_effects.empty()) return nullptr;
+	particle_system* ps = free_attack_effects.back();
+	free_attack_effects.pop_back();
+	return ps;
+}
+
+void map_renderer::release_attack_effect(particle_system* ps) {
+	lock_guard<mutex> guard(attack_effects_lock);
+	// ignore emitters that have already been deleted (map unload)
+	if(find(begin(attack_effects), end(attack_effects), ps) == end(attack_effects)) return;
+	ps->set_active(false);
+	ps->set_visible(false);
+	free_attack_effects.push_back(ps);
+}
+
 bool map_renderer::map_event_handler(EVENT_TYPE type, shared_ptr<event_object> obj a2e_unused) {
 	if(type == EVENT_TYPE::MAP_LOAD) {
 		if(pm == nullptr) return true;
@@ -278,6 +340,32 @@ bool map_renderer::map_event_handler(EVENT_TYPE type, shared_ptr<event_object> o
 			ps->set_visible(ml->enabled);
 		}
 		
+		// attack effect pool
+		auto attack_tex = get_particle_texture("AI_ATTACK");
+		if(attack_tex != nullptr) {
+			lock_guard<mutex> guard(attack_effects_lock);
+			for(size_t i = 0; i < attack_effect_count; i++) {
+				particle_system* ps = pm->add_particle_system(particle_system::EMITTER_TYPE::SPHERE,
+															  particle_system::LIGHTING_TYPE::NONE,
+															  attack_tex,
+															  8192,
+															  500,
+															  5.0f,
+															  float3(0.0f),
+															  float3(0.0f),
+															  float3(0.1f),
+															  float3(0.0f, 1.0, 0.0f),
+															  float3(0.0f),
+															  float3(0.0f, 0.0f, 0.0f),
+															  float4(0.85f, 0.05f, 0.05f, 0.125f),
+															  float2(0.075f, 0.075f));
+				ps->set_active(false);
+				ps->set_visible(false);
+				attack_effects.push_back(ps);
+			}
+			free_attack_effects = attack_effects;
+		}
+		
 		e->release_gl_context();
 		return true;
 	}
@@ -292,6 +380,15 @@ bool map_renderer::map_event_handler(EVENT_TYPE type, shared_ptr<event_object> o
 		}
 		particles.clear();
 		ml_particles.clear();
+		
+		{
+			lock_guard<mutex> guard(attack_effects_lock);
+			for(const auto& ps : attack_effects) {
+				pm->delete_particle_system(ps);
+			}
+			attack_effects.clear();
+			free_attack_effects.clear();
+		}
 		e->release_gl_context();
 		return true;
 	}
@@ -315,9 +412,34 @@ void map_renderer::draw(const DRAW_MODE draw_mode) {
 	
 	a2emodel::pre_draw_setup();
 	
+	matrix4f mvpm_backside;
+	if(env_pass) {
+		quaternionf q_x, q_y;
+		q_x.set_rotation(e->get_rotation()->x, float3(1.0f, 0.0f, 0.0f));
+		q_y.set_rotation(180.0f - e->get_rotation()->y, float3(0.0f, 1.0f, 0.0f));
+		q_y *= q_x;
+		q_y.normalize();
+		mvpm_backside = q_y.to_matrix4();
+		mvpm_backside = *e->get_translation_matrix() * mvpm_backside;
+		mvpm_backside *= *e->get_projection_matrix();
+	}
+	
+	vector<unsigned int>& chunk_list(env_pass ? env_visible_chunks : visible_chunks);
+	if(masked_draw_mode == DRAW_MODE::GEOMETRY_PASS) {
+		update_visible_chunks(chunk_list, env_pass, mvpm_backside);
+	}
+	active_map->update_render_instances();
+	
 	if(masked_draw_mode == DRAW_MODE::MATERIAL_PASS) gl_timer::mark("MAP_START");
 	// type:0 = static map, type:1 = dynamic map
 	for(size_t map_type = 0; map_type < 2; map_type++) {
+		// static map: draw the chunk meshes once all of them are available, otherwise (or w/o culling)
+		// fall back to drawing all blocks instanced
+		const bool draw_meshes = (map_type == 0 && culling && conf::get<bool>("gfx.chunk_meshes") &&
+								  active_map->get_chunk_mesher()->upload());
+		// instanced static map: draw all chunks with a single multi-draw-indirect call if possible
+		const bool draw_indirect = (map_type == 0 && !draw_meshes && active_map->has_indirect_render_data());
+		
 		// inferred rendering
 		gl3shader shd;
 		const string shd_option = (masked_draw_mode == DRAW_MODE::GEOMETRY_PASS ||
@@ -326,6 +448,8 @@ void map_renderer::draw(const DRAW_MODE draw_mode) {
 		set<string> shd_combiners;
 		if(env_pass) shd_combiners.insert("*env_probe");
 		if(map_type == 1) shd_combiners.insert("*dynamic");
+		if(draw_meshes) shd_combiners.insert("*mesh");
+		if(draw_indirect) shd_combiners.insert("*indirect");
 		if(!culling) shd_combiners.insert("*no_cull");
 		
 		if(masked_draw_mode == DRAW_MODE::GEOMETRY_PASS ||
@@ -359,41 +483,95 @@ void map_renderer::draw(const DRAW_MODE draw_mode) {
 		
 		shd->uniform("cam_position", -float3(*e->get_position()));
 		
-		if(env_pass) {
-			quaternionf q_x, q_y;
-			q_x.set_rotation(e->get_rotation()->x, float3(1.0f, 0.0f, 0.0f));
-			q_y.set_rotation(180.0f - e->get_rotation()->y, float3(0.0f, 1.0f, 0.0f));
-			q_y *= q_x;
-			q_y.normalize();
-			matrix4f mvm_backside(q_y.to_matrix4());
-			mvm_backside = *e->get_translation_matrix() * mvm_backside;
-			shd->uniform("mvpm_backside", mvm_backside * *e->get_projection_matrix());
-		}
+		if(env_pass) shd->uniform("mvpm_backside", mvpm_backside);
 		shd->uniform("mvpm", mvpm);
 		
-		shd->attribute_array("in_vertex", draw_vertices_vbo, 3);
-		shd->attribute_array("texture_coord", draw_tex_coords_vbo, 2);
-		shd->attribute_array("normal", draw_normals_vbo, 3);
-		shd->attribute_array("binormal", draw_binormals_vbo, 3);
-		shd->attribute_array("tangent", draw_tangents_vbo, 3);
-		
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, draw_indices_vbo);
-		
-		if(map_type == 0) {
-			if(culling) shd->attribute_array("in_culling", draw_culling_vbo, 1, GL_UNSIGNED_INT);
-			
-			unsigned int chunk_counter = 0;
-			for(const auto& chunk : active_map->get_render_chunks()) {
-				shd->uniform("offset", chunk.offset);
-				shd->block("blocks", chunk.ubo);
-				glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)draw_index_count, GL_UNSIGNED_BYTE, nullptr, sb_map::blocks_per_chunk);
-				chunk_counter++;
+		if(draw_meshes) {
+			const auto& chunk_meshes(active_map->get_chunk_mesher()->get_chunk_meshes());
+			for(const auto& chunk_index : chunk_list) {
+				if(chunk_index >= chunk_meshes.size()) continue;
+				const auto& cmesh(chunk_meshes[chunk_index]);
+				if(cmesh.index_count == 0) continue;
+				shd->uniform("offset", cmesh.offset);
+				shd->attribute_array("in_vertex", cmesh.vertices_vbo, 3);
+				shd->attribute_array("texture_coord", cmesh.tex_coords_vbo, 2);
+				shd->attribute_array("normal", cmesh.normals_vbo, 3);
+				shd->attribute_array("binormal", cmesh.binormals_vbo, 3);
+				shd->attribute_array("tangent", cmesh.tangents_vbo, 3);
+				shd->attribute_array("in_material", cmesh.materials_vbo, 1);
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cmesh.indices_vbo);
+				glDrawElements(GL_TRIANGLES, (GLsizei)cmesh.index_count, GL_UNSIGNED_INT, nullptr);
 			}
 		}
 		else {
-			const pair<GLuint, size_t> render_data(active_map->get_dynamic_render_data());
-			shd->block("blocks", render_data.first);
-			glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)draw_index_count, GL_UNSIGNED_BYTE, nullptr, (GLsizei)render_data.second);
+			shd->attribute_array("in_vertex", draw_vertices_vbo, 3);
+			shd->attribute_array("texture_coord", draw_tex_coords_vbo, 2);
+			shd->attribute_array("normal", draw_normals_vbo, 3);
+			shd->attribute_array("binormal", draw_binormals_vbo, 3);
+			shd->attribute_array("tangent", draw_tangents_vbo, 3);
+			
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, draw_indices_vbo);
+			
+			if(map_type == 0) {
+				if(culling) shd->attribute_array("in_culling", draw_culling_vbo, 1, GL_UNSIGNED_INT);
+				
+				const auto& render_chunks(active_map->get_render_chunks());
+				if(draw_indirect) {
+					// the instances of each chunk start at chunk_index * blocks_per_chunk in the instance buffer
+					indirect_commands.clear();
+					for(const auto& chunk_index : chunk_list) {
+						if(chunk_index >= render_chunks.size()) continue;
+						const auto& chunk(render_chunks[chunk_index]);
+						const size_t instance_count(culling ? chunk.visible_instance_count : chunk.instance_count);
+						if(instance_count == 0) continue;
+						indirect_commands.push_back({
+							(GLuint)draw_index_count, (GLuint)instance_count, 0, 0,
+							(GLuint)(chunk_index * sb_map::blocks_per_chunk)
+						});
+					}
+					
+					if(!indirect_commands.empty()) {
+						if(indirect_buffer == 0) glGenBuffers(1, &indirect_buffer);
+						glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+						glBufferData(GL_DRAW_INDIRECT_BUFFER,
+									 (GLsizeiptr)(indirect_commands.size() * sizeof(draw_elements_indirect_command)),
+									 &indirect_commands[0], GL_STREAM_DRAW);
+						
+						shd->texture("block_data_buffer", active_map->get_block_data_texture(), GL_TEXTURE_BUFFER);
+						shd->uniform("chunk_count", float3(active_map->get_chunk_count()));
+						shd->attribute_array("in_instance", active_map->get_instance_buffer(), 1, GL_UNSIGNED_INT);
+						
+						// in_instance is a per-instance attribute (advanced by the base instance of each command)
+						GLint program = 0;
+						glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+						const GLint instance_location = glGetAttribLocation((GLuint)program, "in_instance");
+						if(instance_location >= 0) glVertexAttribDivisor((GLuint)instance_location, 1);
+						glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_BYTE, nullptr, (GLsizei)indirect_commands.size(), 0);
+						if(instance_location >= 0) glVertexAttribDivisor((GLuint)instance_location, 0);
+						
+						glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+					}
+				}
+				else {
+					// fallback: draw each chunk separately
+					for(const auto& chunk_index : chunk_list) {
+						if(chunk_index >= render_chunks.size()) continue;
+						const auto& chunk(render_chunks[chunk_index]);
+						const size_t instance_count(culling ? chunk.visible_instance_count : chunk.instance_count);
+						if(instance_count == 0) continue;
+						shd->uniform("offset", chunk.offset);
+						shd->block("blocks", chunk.ubo);
+						shd->block("instances", chunk.instance_ubo);
+						glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)draw_index_count, GL_UNSIGNED_BYTE, nullptr, (GLsizei)instance_count);
+					}
+				}
+			}
+			else {
+				for(const auto& batch : active_map->get_dynamic_render_data()) {
+					shd->block("blocks", batch.first);
+					glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)draw_index_count, GL_UNSIGNED_BYTE, nullptr, (GLsizei)batch.second);
+				}
+			}
 		}
 		
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -456,6 +634,8 @@ void map_renderer::draw(const DRAW_MODE draw_mode) {
 		}
 	}
 	
+	draw_entities(draw_mode);
+	
 	// set/check map_link and particle system activity
 	for(const auto& ml : active_map->get_map_links()) {
 		if(ml_particles.count(ml) > 0) {
@@ -467,6 +647,69 @@ void map_renderer::draw(const DRAW_MODE draw_mode) {
 	a2emodel::post_draw_setup();
 }
 
+void map_renderer::update_visible_chunks(vector<unsigned int>& chunk_list, const bool env_pass, const matrix4f& mvpm_backside) {
+	chunk_list.clear();
+	const auto& render_chunks(active_map->get_render_chunks());
+	
+	// clip space component j of a position v is: v.x * m[j] + v.y * m[4 + j] + v.z * m[8 + j] + m[12 + j]
+	const auto clip_row = [](const matrix4f& m, const size_t j) {
+		return float4(m[j], m[4 + j], m[8 + j], m[12 + j]);
+	};
+	// min/max of a clip space row over an aabb
+	const auto row_min = [](const float4& row, const float3& bmin, const float3& bmax) {
+		return (std::min(row.x * bmin.x, row.x * bmax.x) +
+				std::min(row.y * bmin.y, row.y * bmax.y) +
+				std::min(row.z * bmin.z, row.z * bmax.z) + row.w);
+	};
+	const auto row_max = [](const float4& row, const float3& bmin, const float3& bmax) {
+		return (std::max(row.x * bmin.x, row.x * bmax.x) +
+				std::max(row.y * bmin.y, row.y * bmax.y) +
+				std::max(row.z * bmin.z, row.z * bmax.z) + row.w);
+	};
+	
+	if(!env_pass) {
+		// frustum planes: w + x, w - x, w + y, w - y, w + z, w - z (all >= 0 inside)
+		const float4 row_x(clip_row(mvpm, 0)), row_y(clip_row(mvpm, 1)), row_z(clip_row(mvpm, 2)), row_w(clip_row(mvpm, 3));
+		const array<float4, 6> planes {
+			{
+				row_w + row_x, row_w - row_x,
+				row_w + row_y, row_w - row_y,
+				row_w + row_z, row_w - row_z,
+			}
+		};
+		for(unsigned int chunk_index = 0, count = (unsigned int)render_chunks.size(); chunk_index < count; chunk_index++) {
+			const auto& chunk(render_chunks[chunk_index]);
+			if(active_map->get_chunk_block_count(chunk_index) == 0) continue;
+			bool visible = true;
+			for(const auto& plane : planes) {
+				if(row_max(plane, chunk.content_min, chunk.content_max) < 0.0f) {
+					visible = false;
+					break;
+				}
+			}
+			if(visible) chunk_list.push_back(chunk_index);
+		}
+	}
+	else {
+		// dual-paraboloid: a chunk is drawn if it is visible from either side. a side rejects everything
+		// behind it (z < 0) and everything beyond the depth range: depth = length * z / env_probe_depth
+		// and length >= z, so the chunk is out of range if its min z exceeds sqrt(env_probe_depth)
+		static constexpr float env_probe_depth = 1000.0f; // see env_probe.a2eshdi
+		const array<float4, 2> z_rows { { clip_row(mvpm, 2), clip_row(mvpm_backside, 2) } };
+		for(unsigned int chunk_index = 0, count = (unsigned int)render_chunks.size(); chunk_index < count; chunk_index++) {
+			const auto& chunk(render_chunks[chunk_index]);
+			if(active_map->get_chunk_block_count(chunk_index) == 0) continue;
+			for(const auto& z_row : z_rows) {
+				if(row_max(z_row, chunk.content_min, chunk.content_max) < 0.0f) continue;
+				const float min_z(row_min(z_row, chunk.content_min, chunk.content_max));
+				if(min_z > 0.0f && min_z * min_z > env_probe_depth) continue;
+				chunk_list.push_back(chunk_index);
+				break;
+			}
+		}
+	}
+}
+
 void map_renderer::set_culling(const bool& state) {
 	culling = state;
 }
@@ -29,6 +29,14 @@
 
 class block_textures;
 class particle_system;
+class physics_entity;
+
+// model and material shared by all physics entities with the same model/material/scale
+struct entity_model {
+	a2estatic* model;
+	a2ematerial* material;
+};
+
 class map_renderer : protected a2estatic {
 public:
 	map_renderer();
@@ -40,12 +48,38 @@ public:
 	
 	a2e_texture get_particle_texture(const string& name);
 	
+	// attack effects are shared by all ais: an emitter is borrowed for the duration of an attack and
+	// returned afterwards (returns nullptr if all emitters are in use or there is no particle manager)
+	particle_system* acquire_attack_effect();
+	void release_attack_effect(particle_system* ps);
+	
+	// loads the model and material on first use, all later calls return the same entity model
+	// note: must be called from the main/render thread
+	entity_model* get_entity_model(const string& model_filename, const string& material_filename, const float3& scale);
+	
 protected:
 	event::handler map_event_handler_fctr;
 	bool map_event_handler(EVENT_TYPE type, shared_ptr<event_object> obj);
 	
 	GLuint draw_culling_vbo = 0;
 	
+	// per-chunk visibility: computed once per view in the geometry pass and reused by the material pass
+	// (the environment probe pass has its own list, culled against both of its paraboloids)
+	vector<unsigned int> visible_chunks;
+	vector<unsigned int> env_visible_chunks;
+	void update_visible_chunks(vector<unsigned int>& chunk_list, const bool env_pass, const matrix4f& mvpm_backside);
+	
+	// multi-draw-indirect (if the map has indirect render data): one draw command per visible chunk
+	struct draw_elements_indirect_command {
+		GLuint count;
+		GLuint instance_count;
+		GLuint first_index;
+		GLint base_vertex;
+		GLuint base_instance;
+	};
+	vector<draw_elements_indirect_command> indirect_commands;
+	GLuint indirect_buffer = 0;
+	
 	a2estatic* push_button = nullptr;
 	array<a2ematerial*, 2> push_button_mat { { nullptr, nullptr } }; // off, on
 	
@@ -60,6 +94,16 @@ protected:
 	unordered_map<sb_map::map_link*, particle_system*> ml_particles;
 	unordered_map<string, a2e_texture> particle_textures;
 	
+	// shared entity models (owned by the map renderer and drawn once per entity)
+	unordered_map<string, entity_model*> entity_models;
+	void draw_entities(const DRAW_MODE draw_mode);
+	
+	// attack effect pool (created on map load)
+	static constexpr size_t attack_effect_count = 4;
+	vector<particle_system*> attack_effects;
+	vector<particle_system*> free_attack_effects;
+	mutex attack_effects_lock;
+	
 	bool culling = true;
 	
 };
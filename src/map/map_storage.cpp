@@ -63,11 +63,15 @@ const unordered_map<unsigned int, unsigned int> map_storage::data_versions {
 	{ (unsigned int)map_storage::DATA_TYPES::AUDIO_BACKGROUND, 1 },
 	{ (unsigned int)map_storage::DATA_TYPES::AUDIO_3D, 1 },
 	{ (unsigned int)map_storage::DATA_TYPES::MAP_LINK, 2 },
-	{ (unsigned int)map_storage::DATA_TYPES::TRIGGER, 2 },
+	{ (unsigned int)map_storage::DATA_TYPES::TRIGGER, 3 },
 	{ (unsigned int)map_storage::DATA_TYPES::LIGHT_COLOR_AREA, 1 },
 	{ (unsigned int)map_storage::DATA_TYPES::AI_WAYPOINT, 1 },
 };
 
+const unordered_multimap<unsigned int, pair<unsigned int, map_storage::load_function>> map_storage::legacy_loaders {
+	{ (unsigned int)map_storage::DATA_TYPES::TRIGGER, { 2, &map_storage::load_trigger_v2 } },
+};
+
 sb_map* map_storage::load(const string& filename) {
 	file_io file(e->data_path("maps/"+filename), file_io::OPEN_TYPE::READ_BINARY);
 	if(!file.is_open()) {
@@ -125,18 +129,29 @@ sb_map* map_storage::load(const string& filename) {
 				continue;
 			}
 			
-			// check if the loader is for the correct version
+			// check if the loader is for the correct version (or if there is a legacy loader for this version)
+			load_function loader = loaders.at(type);
 			if(version != data_versions.at(type)) {
-				a2e_error("invalid '%s' version: %u, should be %u!",
+				const auto legacy_range = legacy_loaders.equal_range(type);
+				const auto legacy_iter = find_if(legacy_range.first, legacy_range.second,
+												 [&version](const pair<const unsigned int, pair<unsigned int, load_function>>& legacy) {
+													 return (legacy.second.first == version);
+												 });
+				if(legacy_iter == legacy_range.second) {
+					a2e_error("invalid '%s' version: %u, should be %u!",
+							  SB_DATA_TYPE_TO_STR(type), version, data_versions.at(type));
+					// ignore struct and seek ahead
+					file.seek((size_t)file.get_current_offset() + data_length);
+					continue;
+				}
+				a2e_debug("converting '%s' from version %u to %u",
 						  SB_DATA_TYPE_TO_STR(type), version, data_versions.at(type));
-				// ignore struct and seek ahead
-				file.seek((size_t)file.get_current_offset() + data_length);
-				continue;
+				loader = legacy_iter->second.second;
 			}
 			
 			// load the data
 			const long long int start_offset = file.get_current_offset();
-			loaders.at(type)(file, *level);
+			loader(file, *level);
 			const long long int end_offset = file.get_current_offset();
 #if !defined(__APPLE__) || defined(A2E_DEBUG) // fails on 10.7's libc++, but works on 10.8
 			if((end_offset - start_offset) != data_length) { // check length
@@ -359,6 +374,14 @@ bool map_storage::load_map_link(file_io& file, sb_map& level) {
 }
 
 bool map_storage::load_trigger(file_io& file, sb_map& level) {
+	return load_trigger_data(file, level, data_versions.at((unsigned int)DATA_TYPES::TRIGGER));
+}
+
+bool map_storage::load_trigger_v2(file_io& file, sb_map& level) {
+	return load_trigger_data(file, level, 2);
+}
+
+bool map_storage::load_trigger_data(file_io& file, sb_map& level, const unsigned int version) {
 	string identifier = "";
 	file.get_terminated_block(identifier, 0);
 	if(identifier.length() == 0) {
@@ -395,6 +418,13 @@ bool map_storage::load_trigger(file_io& file, sb_map& level) {
 	switch(type) {
 		case TRIGGER_TYPE::WEIGHT:
 			weight = file.get_float();
+			if(version < 3) {
+				// v2 stored the mass of the weight slider tray, which was held up by a motor with a max force
+				// of 100 -> the required load was everything exceeding that force (minus the tray itself).
+				// note: the old slider already fired after 7.5% travel, so a single character was always
+				// enough -> never require more than one character (this covers the old 0.1 default)
+				weight = core::clamp((100.0f / 9.81f) - weight, 0.0f, physics_controller::character_mass);
+			}
 			break;
 		case TRIGGER_TYPE::LIGHT:
 			intensity = file.get_float();
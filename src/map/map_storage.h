@@ -51,6 +51,8 @@ protected:
 	static const unordered_map<unsigned int, load_function> loaders;
 	static const unordered_map<unsigned int, save_function> savers;
 	static const unordered_map<unsigned int, unsigned int> data_versions;
+	// loaders for older struct versions that can still be converted (type -> { version, loader })
+	static const unordered_multimap<unsigned int, pair<unsigned int, load_function>> legacy_loaders;
 	
 	// loaders:
 	static bool load_map_data(file_io& file, sb_map& level);
@@ -58,6 +60,8 @@ protected:
 	static bool load_audio_3d(file_io& file, sb_map& level);
 	static bool load_map_link(file_io& file, sb_map& level);
 	static bool load_trigger(file_io& file, sb_map& level);
+	static bool load_trigger_v2(file_io& file, sb_map& level);
+	static bool load_trigger_data(file_io& file, sb_map& level, const unsigned int version);
 	static bool load_light_color_area(file_io& file, sb_map& level);
 	static bool load_ai_waypoint(file_io& file, sb_map& level);
 	
@@ -26,7 +26,10 @@
 #include "ai_entity.h"
 #include "script_handler.h"
 #include "script.h"
-#include "weight_slider.h"
+#include "weight_sensor.h"
+#include "kinematic_spring.h"
+#include "pathfinder.h"
+#include "chunk_mesher.h"
 #include "map_storage.h"
 #include "save.h"
 #include <rendering/extensions.h>
@@ -36,28 +39,85 @@
 constexpr unsigned int sb_map::map_version;
 constexpr size_t sb_map::chunk_extent;
 constexpr size_t sb_map::blocks_per_chunk;
+constexpr size_t sb_map::dynamic_batch_size;
+constexpr unsigned int sb_map::render_flip_flag;
+constexpr unsigned int sb_map::instance_chunk_shift;
+static_assert((1u << sb_map::instance_chunk_shift) == sb_map::blocks_per_chunk,
+			  "instance_chunk_shift must match the amount of blocks per chunk");
+constexpr float sb_map::block_light_radius;
+
+// positions (relative to the block an entity stands in) at which magnet/spring blocks affect the entity
+static const array<int3, 14> magnet_offsets {
+	{
+		int3(-1, 0, 0), int3(1, 0, 0), int3(0, 0, -1), int3(0, 0, 1),
+		int3(-1, 1, 0), int3(1, 1, 0), int3(0, 1, -1), int3(0, 1, 1),
+		int3(-1, 2, 0), int3(1, 2, 0), int3(0, 2, -1), int3(0, 2, 1),
+		int3(0, -1, 0), int3(0, 3, 0),
+	}
+};
+static const array<int3, 28> spring_block_offsets {
+	{
+		int3(-2, 0, 0), int3(-1, 0, 0), int3(1, 0, 0), int3(2, 0, 0),
+		int3(0, 0, -2), int3(0, 0, -1), int3(0, 0, 1), int3(0, 0, 2),
+		int3(-2, 1, 0), int3(-1, 1, 0), int3(1, 1, 0), int3(2, 1, 0),
+		int3(0, 1, -2), int3(0, 1, -1), int3(0, 1, 1), int3(0, 1, 2),
+		int3(-2, 2, 0), int3(-1, 2, 0), int3(1, 2, 0), int3(2, 2, 0),
+		int3(0, 2, -2), int3(0, 2, -1), int3(0, 2, 1), int3(0, 2, 2),
+		int3(0, -2, 0), int3(0, -1, 0), int3(0, 1, 0), int3(0, 2, 0),
+	}
+};
+
+// possible spawn positions (relative to the spawner), bit i of a spawners free neighbor mask corresponds to offset i
+static const array<int3, 6> spawner_offsets {
+	{
+		int3(1, 0, 0),
+		int3(-1, 0, 0),
+		int3(0, 1, 0),
+		int3(0, -1, 0),
+		int3(0, 0, 1),
+		int3(0, 0, -1),
+	}
+};
+// time between two spawns of a spawner (in ms)
+static constexpr unsigned int spawner_cooldown = 500;
+
+// removes an object from its symbol index (another object with the same identifier will take its place)
+template <typename T> static void unregister_symbol(symbol_index<T>& index, const vector<T*>& objects, const T* obj) {
+	const symbol sym(symbol_table::lookup(obj->identifier));
+	index.erase(sym, obj);
+	if(index.get(sym) != nullptr) return;
+	for(const auto& other : objects) {
+		if(other != obj && other->identifier == obj->identifier) {
+			index.insert(sym, other);
+			break;
+		}
+	}
+}
 
 sb_map::sb_map(const string& filename_) :
 filename(filename_),
 block_rinfo(&pc->add_rigid_info<physics_controller::SHAPE::BOX>(0.0f, float3(0.5f))),
 evt_handler_fnctr(this, &sb_map::event_handler)
 {
-	dynamic_render_data_size = 0;
-	glGenBuffers(1, &dynamic_bodies_ubo);
-	glBindBuffer(GL_UNIFORM_BUFFER, dynamic_bodies_ubo);
-	glBufferData(GL_UNIFORM_BUFFER, 65536, nullptr, GL_DYNAMIC_DRAW);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
-	
+	pf = new pathfinder();
+	mesher = new chunk_mesher();
+	pc->set_ai_store(&ais);
 	eevt->add_event_handler(evt_handler_fnctr,
 							EVENT_TYPE::PLAYER_STEP, EVENT_TYPE::PLAYER_BLOCK_STEP,
-							EVENT_TYPE::AI_STEP, EVENT_TYPE::AI_BLOCK_STEP);
+							EVENT_TYPE::AI_STEP, EVENT_TYPE::AI_BLOCK_STEP,
+							EVENT_TYPE::WEIGHT_SENSOR_CHANGE, EVENT_TYPE::SPRING_CHANGE);
 }
 
 sb_map::~sb_map() {
 	eevt->remove_event_handler(evt_handler_fnctr);
 	
 	render_chunks.clear();
-	if(glIsBuffer(dynamic_bodies_ubo)) glDeleteBuffers(1, &dynamic_bodies_ubo);
+	delete_indirect_render_data();
+	delete mesher;
+	for(const auto& ubo : dynamic_bodies_ubos) {
+		if(glIsBuffer(ubo)) glDeleteBuffers(1, &ubo);
+	}
+	dynamic_bodies_ubos.clear();
 	
 	for(const auto& light_container : lights) {
 		for(const auto& l : light_container) {
@@ -70,11 +130,10 @@ sb_map::~sb_map() {
 	pc->lock();
 	for(const auto& sp : springs) {
 		// must be called before killing all other dynamic_bodies!
-		dynamic_bodies.erase(sp->body);
-		pc->remove_rigid_body(sp->body);
-		pc->remove_rigid_info(sp->info);
-		delete sp;
+		remove_dynamic_body(sp->get_body());
+		pc->remove_kinematic_spring(sp);
 	}
+	springs.clear();
 	pc->unlock();
 	
 	for(const auto& sbody_container : static_bodies) {
@@ -103,9 +162,13 @@ sb_map::~sb_map() {
 		delete ml;
 	}
 	
-	for(const auto& entity : entities) {
+	pc->set_ai_store(nullptr);
+	for(const auto& entity : ais.get_entities()) {
 		delete entity;
 	}
+	ais.clear();
+	// note: must be deleted after all ai entities
+	delete pf;
 	
 	for(const auto& spwn : spawners) {
 		delete spwn;
@@ -113,7 +176,7 @@ sb_map::~sb_map() {
 	
 	for(const auto& trgr : triggers) {
 		if(trgr->type == TRIGGER_TYPE::WEIGHT) {
-			pc->remove_weight_slider(trgr->state.slider);
+			pc->remove_weight_sensor(trgr->state.sensor);
 		}
 		delete trgr;
 	}
@@ -126,96 +189,45 @@ sb_map::~sb_map() {
 
 void sb_map::run() {
 	ge->graphics_update();
-	for(const auto& entity : entities) {
+	for(const auto& entity : ais.get_entities()) {
 		entity->graphics_update();
 	}
 	
-	// spring handling
-	vector<spring*> del_springs;
-	pc->lock();
 	const unsigned int cur_ticks(SDL_GetTicks());
-	for(const auto& sp : springs) {
-		static const unsigned int ext_time = 3000;
-		const float step_size = 0.0025f; // extension / ms
-		sp->scale = core::clamp((sp->state >= 0.0f ? 0.0f : 1.0f) + sp->state * step_size * float(cur_ticks - sp->timer), 0.0f, 1.0f);
-		
-		const float3 dir_abs(sp->direction.abs());
-		// non-dir scale: 1.0, dir scale: [0, 2]
-		sp->body->set_scale((float3(1.0f) - dir_abs) + dir_abs * sp->scale * 2.0f);
-		// start off by one block into the extension direction (on the spring block side), then accommodate for scale
-		sp->body->set_position(float3(sp->position) + (float3(1.0f) + sp->direction) * 0.5f + sp->direction * sp->scale);
-		
-		if(sp->scale == 1.0f && (cur_ticks - sp->timer) > ext_time) {
-			// fully extended and extension period is over -> retract
-			sp->state = -sp->state;
-			sp->timer = cur_ticks;
-			play_sound("SPRING", sp->position);
-		}
-		else if(sp->scale == 0.0f) {
-			// fully retracted and retraction period is over -> delete
-			del_springs.push_back(sp);
-		}
-	}
-	for(const auto& sp : del_springs) {
-		const auto iter = find(begin(springs), end(springs), sp);
-		if(iter != end(springs)) {
-			springs.erase(iter);
-		}
-		dynamic_bodies.erase(sp->body);
-		pc->remove_rigid_body(sp->body);
-		pc->remove_rigid_info(sp->info);
-		delete sp;
-	}
-	pc->unlock();
 	
 	// trigger handling
 	for(auto& trgr : triggers) {
 		if(trgr->sub_type == TRIGGER_SUB_TYPE::TIMED &&
 		   trgr->state.timer != 0 && trgr->state.timer < cur_ticks) {
 			trgr->deactivate(this);
-		}
-		
-		if(trgr->type == TRIGGER_TYPE::WEIGHT) {
-			const bool triggered(trgr->state.slider->is_triggered());
-			if(!trgr->state.active && triggered) {
+			// weight sensors only signal transitions -> reactivate if there is still enough weight on the plate
+			if(trgr->type == TRIGGER_TYPE::WEIGHT && trgr->state.sensor->is_triggered()) {
 				trgr->activate(this);
 			}
-			else if(trgr->state.active && !triggered) {
-				trgr->deactivate(this);
-			}
 		}
 	}
 	
-	// spawner handling
+	// spawner handling (the free neighbor masks are kept up-to-date in update)
 	for(const auto& spwn : spawners) {
 		// check if an ai entity must be spawned
-		if(spwn->spawns.size() < spwn->max_spawns) {
-			// find a valid direction/position
-			static const array<int3, 6> offsets {
-				{
-					int3(1, 0, 0),
-					int3(-1, 0, 0),
-					int3(0, 1, 0),
-					int3(0, -1, 0),
-					int3(0, 0, 1),
-					int3(0, 0, -1),
-				}
-			};
-			vector<uint3> valid_positions;
-			for(size_t i = 0; i < offsets.size(); i++) {
-				const uint3 pos(spwn->position + offsets[i]);
-				if(is_valid_position(pos)) {
-					if(get_block(pos).material == BLOCK_MATERIAL::NONE) {
-						valid_positions.push_back(pos);
-					}
-				}
-			}
-			if(!valid_positions.empty()) {
-				const uint3 rand_pos(valid_positions[core::rand((int)valid_positions.size())]);
-				spwn->spawns.insert(add_ai_entity(rand_pos));
-			}
-			else {
-				a2e_error("no valid spawn position found for spawner @%v!", spwn->position);
+		if(spwn->spawns.size() >= spwn->max_spawns ||
+		   spwn->free_neighbors == 0 ||
+		   cur_ticks < spwn->next_spawn_ticks) {
+			continue;
+		}
+		spwn->next_spawn_ticks = cur_ticks + spawner_cooldown;
+		
+		// pick a random free neighbor
+		unsigned int free_count = 0;
+		for(size_t i = 0; i < spawner_offsets.size(); i++) {
+			if((spwn->free_neighbors & (1u << i)) != 0) free_count++;
+		}
+		int rand_idx = core::rand((int)free_count);
+		for(size_t i = 0; i < spawner_offsets.size(); i++) {
+			if((spwn->free_neighbors & (1u << i)) == 0) continue;
+			if(rand_idx-- == 0) {
+				spwn->spawns.insert(add_ai_entity(uint3(int3(spwn->position) + spawner_offsets[i])));
+				break;
 			}
 		}
 	}
@@ -225,7 +237,7 @@ void sb_map::run() {
 
 void sb_map::update(const unsigned int& chunk_index, const uint3& local_position, const BLOCK_MATERIAL& mat) {
 	const unsigned int block_idx = block_position_to_index(local_position);
-	const BLOCK_MATERIAL& old_mat(chunks[chunk_index][block_idx].material);
+	const BLOCK_MATERIAL old_mat(chunks[chunk_index][block_idx].material);
 	const uint3 position(chunk_extent * chunk_index_to_position(chunk_index) + local_position);
 	const float3 center_position(float3(position) + 0.5f);
 	
@@ -262,7 +274,7 @@ void sb_map::update(const unsigned int& chunk_index, const uint3& local_position
 	}
 	
 	// add event
-	eevt->add_event(EVENT_TYPE::BLOCK_CHANGE, make_shared<block_change_event>(SDL_GetTicks(), chunk_index, block_idx, old_mat, mat));
+	eevt->add_event(EVENT_TYPE::BLOCK_CHANGE, make_shared<block_change_event>(SDL_GetTicks(), chunk_index, block_idx, position, old_mat, mat));
 	
 	// handle light blocks:
 	if(old_mat != BLOCK_MATERIAL::LIGHT &&
@@ -270,7 +282,7 @@ void sb_map::update(const unsigned int& chunk_index, const uint3& local_position
 	   lights[chunk_index].count(block_idx) == 0) {
 		// add light
 		light* l = new light(center_position);
-		l->set_radius(16.0f);
+		l->set_radius(block_light_radius);
 		l->set_color(compute_light_color_for_position(position));
 		sce->add_light(l);
 		lights[chunk_index].insert(make_pair(block_idx, l));
@@ -300,6 +312,10 @@ void sb_map::update(const unsigned int& chunk_index, const uint3& local_position
 		for(const auto& trgr : triggers) {
 			if(trgr->type != TRIGGER_TYPE::LIGHT) continue;
 			
+			// the intensity of triggers outside the light radius can't have changed
+			const float3 trgr_dir(float3(trgr->position) + 0.5f - center_position);
+			if(trgr_dir.dot(trgr_dir) >= block_light_radius * block_light_radius) continue;
+			
 			const float intensity = light_intensity_for_position(trgr->position);
 			if(trgr->state.active && intensity < trgr->intensity) {
 				trgr->deactivate(this);
@@ -311,7 +327,53 @@ void sb_map::update(const unsigned int& chunk_index, const uint3& local_position
 	}
 	
 	// and finally: update data
+	if(old_mat == BLOCK_MATERIAL::NONE && mat != BLOCK_MATERIAL::NONE) chunk_block_counts[chunk_index]++;
+	else if(old_mat != BLOCK_MATERIAL::NONE && mat == BLOCK_MATERIAL::NONE) chunk_block_counts[chunk_index]--;
 	chunks[chunk_index][block_idx].material = mat;
+	if(old_mat == BLOCK_MATERIAL::NONE && mat != BLOCK_MATERIAL::NONE) {
+		// grow the render bounds of the chunk
+		chunk_render_data& crd(render_chunks[chunk_index]);
+		const float3 block_min(position), block_max(float3(position) + 1.0f);
+		if(chunk_block_counts[chunk_index] == 1) {
+			crd.content_min = block_min;
+			crd.content_max = block_max;
+		}
+		else {
+			crd.content_min.min(block_min);
+			crd.content_max.max(block_max);
+		}
+	}
+	else if(old_mat != BLOCK_MATERIAL::NONE && mat == BLOCK_MATERIAL::NONE) {
+		// only blocks on the border of the render bounds can shrink them
+		const chunk_render_data& crd(render_chunks[chunk_index]);
+		const float3 block_min(position), block_max(float3(position) + 1.0f);
+		if(block_min.x == crd.content_min.x || block_min.y == crd.content_min.y || block_min.z == crd.content_min.z ||
+		   block_max.x == crd.content_max.x || block_max.y == crd.content_max.y || block_max.z == crd.content_max.z) {
+			update_render_bounds(chunk_index);
+		}
+	}
+	if(old_mat != mat) {
+		// note: must be done after the material has been changed
+		if(old_mat == BLOCK_MATERIAL::MAGNET || mat == BLOCK_MATERIAL::MAGNET) {
+			update_neighbor_flags(int3(position), magnet_offsets.data(), magnet_offsets.size(),
+								  BLOCK_MATERIAL::MAGNET, NEIGHBOR_FLAG::MAGNET, mat == BLOCK_MATERIAL::MAGNET);
+		}
+		if(old_mat == BLOCK_MATERIAL::SPRING || mat == BLOCK_MATERIAL::SPRING) {
+			update_neighbor_flags(int3(position), spring_block_offsets.data(), spring_block_offsets.size(),
+								  BLOCK_MATERIAL::SPRING, NEIGHBOR_FLAG::SPRING, mat == BLOCK_MATERIAL::SPRING);
+		}
+	}
+	if(!spawners.empty() && (old_mat == BLOCK_MATERIAL::NONE) != (mat == BLOCK_MATERIAL::NONE)) {
+		// update the free neighbor mask of all adjacent spawners
+		for(const auto& offset : spawner_offsets) {
+			const int3 spawner_pos(int3(position) - offset);
+			if(spawner_pos.x < 0 || spawner_pos.y < 0 || spawner_pos.z < 0) continue;
+			const auto spwn_iter = spawner_positions.find(pack_position(uint3(spawner_pos)));
+			if(spwn_iter != spawner_positions.end()) {
+				update_spawner_neighbors(spwn_iter->second);
+			}
+		}
+	}
 	const int3 max_extent(chunk_count * chunk_extent);
 	
 	// update render chunks data
@@ -334,7 +396,7 @@ void sb_map::update(const unsigned int& chunk_index, const uint3& local_position
 		if(pos.x >= max_extent.x || pos.y >= max_extent.y || pos.z >= max_extent.z) return;
 		
 		const unsigned int index(block_position_to_index(pos % chunk_extent));
-		unsigned int block_mat = (unsigned int)accessor(pos);
+		const unsigned int block_mat = block_render_material(accessor(pos));
 		unsigned int culling_data = 0;
 		{
 			// bottom
@@ -362,32 +424,27 @@ void sb_map::update(const unsigned int& chunk_index, const uint3& local_position
 							 (unsigned int)BLOCK_FACE::INVALID : (unsigned int)BLOCK_FACE::LEFT);
 		}
 		
-		// flag if material texture should be flipped horizontally every other y layer
-		static const vector<bool> flip_mat {
-			{
-				false,	// NONE,
-				true,	// INDESTRUCTIBLE,
-				false,	// METAL,
-				false,	// __PLACEHOLDER_0,
-				false,	// MAGNET,
-				false,	// LIGHT,
-				false,	// __PLACEHOLDER_1,
-				false,	// ACID,
-				false,	// __PLACEHOLDER_2,
-				false,	// __PLACEHOLDER_3,
-				false,	// SPRING,
-				false,	// SPAWNER,
-				false,	// __MAX_BLOCK_MATERIAL
-			}
-		};
-		const bool flip_material = flip_mat[block_mat];
-		block_mat = remap_material((BLOCK_MATERIAL)block_mat);
-		if(flip_material) block_mat |= 0x8000;
-		
 		//
 		const unsigned int render_data = block_mat + (culling_data << 16);
-		glBindBuffer(GL_UNIFORM_BUFFER, render_chunks[chunk_position_to_index(pos / chunk_extent)].ubo);
+		const unsigned int render_chunk_index(chunk_position_to_index(pos / chunk_extent));
+		chunk_render_data& crd(render_chunks[render_chunk_index]);
+		glBindBuffer(GL_UNIFORM_BUFFER, crd.ubo);
 		glBufferSubData(GL_UNIFORM_BUFFER, index * sizeof(unsigned int), sizeof(unsigned int), &render_data);
+		if(indirect_data_buffer != 0) {
+			glBindBuffer(GL_TEXTURE_BUFFER, indirect_data_buffer);
+			glBufferSubData(GL_TEXTURE_BUFFER, (GLintptr)((render_chunk_index * blocks_per_chunk + index) * sizeof(unsigned int)),
+							sizeof(unsigned int), &render_data);
+		}
+		
+		// the instance list only needs to be recompacted if the block became (non-)empty or (in)visible
+		const auto block_visibility = [](const unsigned int& data) -> unsigned int {
+			if((data & 0x7FFFu) == 0) return 0;
+			return ((data >> 16u) == (unsigned int)BLOCK_FACE::ALL ? 1 : 2);
+		};
+		if(block_visibility(crd.data[index]) != block_visibility(render_data)) {
+			crd.instances_dirty = true;
+		}
+		crd.data[index] = render_data;
 	};
 	
 	const int3 global_position(chunk_index_to_position(chunk_index) * chunk_extent + local_position);
@@ -402,20 +459,30 @@ void sb_map::update(const unsigned int& chunk_index, const uint3& local_position
 	update_culling_data(int3(global_position.x, global_position.y, global_position.z + 1));
 	
 	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	if(indirect_data_buffer != 0) glBindBuffer(GL_TEXTURE_BUFFER, 0);
 }
 
 float sb_map::light_intensity_for_position(const uint3& global_position) const {
 	float intensity = 0.0f;
 	const float3 pos(float3(global_position) + 0.5f);
-	for(const auto& chunk_lights : lights) {
-		for(const auto& block_light : chunk_lights) {
-			const light* li(block_light.second);
-			
-			// attenuation = distance / light_radius^4
-			const float3 light_dir((li->get_position() - pos) * li->get_inv_sqr_radius());
-			const float attenuation(1.0f - light_dir.dot(light_dir) * li->get_sqr_radius());
-			if(attenuation > 0.0f) {
-				intensity += li->get_radius() * attenuation;
+	
+	// only visit chunks that can contain a light within range
+	const float3 max_pos(float3(chunk_count * chunk_extent) - 1.0f);
+	const uint3 min_chunk(float3::max(pos - block_light_radius, float3(0.0f)) / float(chunk_extent));
+	const uint3 max_chunk(float3::min(pos + block_light_radius, max_pos) / float(chunk_extent));
+	for(unsigned int cy = min_chunk.y; cy <= max_chunk.y; cy++) {
+		for(unsigned int cz = min_chunk.z; cz <= max_chunk.z; cz++) {
+			for(unsigned int cx = min_chunk.x; cx <= max_chunk.x; cx++) {
+				for(const auto& block_light : lights[chunk_position_to_index(uint3(cx, cy, cz))]) {
+					const light* li(block_light.second);
+					
+					// attenuation = distance / light_radius^4
+					const float3 light_dir((li->get_position() - pos) * li->get_inv_sqr_radius());
+					const float attenuation(1.0f - light_dir.dot(light_dir) * li->get_sqr_radius());
+					if(attenuation > 0.0f) {
+						intensity += li->get_radius() * attenuation;
+					}
+				}
 			}
 		}
 	}
@@ -478,6 +545,65 @@ const sb_map::block_data& sb_map::get_block(const uint3& global_position) const
 	return chunks[chunk_index][block_index];
 }
 
+unsigned int sb_map::get_chunk_block_count(const unsigned int& chunk_index) const {
+	return chunk_block_counts[chunk_index];
+}
+
+unsigned char sb_map::get_neighbor_flags(const uint3& global_position) const {
+	const unsigned int chunk_index(chunk_position_to_index(global_position / chunk_extent));
+	const unsigned int block_index(sb_map::block_position_to_index(global_position % chunk_extent));
+	return neighbor_flags[chunk_index][block_index];
+}
+
+void sb_map::update_neighbor_flags(const int3& position, const int3* offsets, const size_t offset_count,
+								   const BLOCK_MATERIAL& flag_material, const NEIGHBOR_FLAG& flag, const bool added) {
+	for(size_t i = 0; i < offset_count; i++) {
+		const int3 entity_pos(position - offsets[i]);
+		if(!is_valid_position(entity_pos)) continue;
+		
+		unsigned char& flags(neighbor_flags[chunk_position_to_index(uint3(entity_pos) / chunk_extent)]
+										   [block_position_to_index(uint3(entity_pos) % chunk_extent)]);
+		if(added) {
+			flags |= (unsigned char)flag;
+			continue;
+		}
+		
+		// removed: there might still be another block of that material within reach
+		bool in_reach = false;
+		for(size_t j = 0; j < offset_count; j++) {
+			const int3 block_pos(entity_pos + offsets[j]);
+			if(is_valid_position(block_pos) && get_block(block_pos).material == flag_material) {
+				in_reach = true;
+				break;
+			}
+		}
+		if(in_reach) flags |= (unsigned char)flag;
+		else flags &= ~(unsigned char)flag;
+	}
+}
+
+void sb_map::rebuild_neighbor_flags() {
+	for(auto& chunk_flags : neighbor_flags) {
+		chunk_flags.fill((unsigned char)NEIGHBOR_FLAG::NONE);
+	}
+	for(unsigned int chunk_index = 0, chnk_count = (unsigned int)chunks.size(); chunk_index < chnk_count; chunk_index++) {
+		if(chunk_block_counts[chunk_index] == 0) continue;
+		const int3 chunk_origin(chunk_index_to_position(chunk_index) * chunk_extent);
+		for(unsigned int block_index = 0; block_index < blocks_per_chunk; block_index++) {
+			const BLOCK_MATERIAL& mat(chunks[chunk_index][block_index].material);
+			const int3 position(chunk_origin + int3(block_index_to_position(block_index)));
+			if(mat == BLOCK_MATERIAL::MAGNET) {
+				update_neighbor_flags(position, magnet_offsets.data(), magnet_offsets.size(),
+									  BLOCK_MATERIAL::MAGNET, NEIGHBOR_FLAG::MAGNET, true);
+			}
+			else if(mat == BLOCK_MATERIAL::SPRING) {
+				update_neighbor_flags(position, spring_block_offsets.data(), spring_block_offsets.size(),
+									  BLOCK_MATERIAL::SPRING, NEIGHBOR_FLAG::SPRING, true);
+			}
+		}
+	}
+}
+
 void sb_map::resize(const uint3& chunk_count_) {
 	pc->lock();
 	
@@ -524,9 +650,16 @@ void sb_map::resize(const uint3& chunk_count_) {
 	chunk_count = chunk_count_;
 	const size_t total_chunk_count = chunk_count.x * chunk_count.y * chunk_count.z;
 	chunks.resize(total_chunk_count);
+	chunk_block_counts.resize(total_chunk_count);
 	static_bodies.resize(total_chunk_count);
 	dynamic_body_field.resize(total_chunk_count);
 	lights.resize(total_chunk_count);
+	neighbor_flags.resize(total_chunk_count);
+	chunk_light_color_areas.clear();
+	chunk_light_color_areas.resize(total_chunk_count);
+	for(const auto& lca : light_color_areas) {
+		index_light_color_area(lca);
+	}
 	
 	// copy old data into new containers
 	if(live_resize) {
@@ -555,19 +688,29 @@ void sb_map::resize(const uint3& chunk_count_) {
 		}
 	}
 	
-	// render data (at the moment just empty data ...)
+	// render data (at the moment just empty data ...) and block counts
 	size_t chunk_counter = 0;
 	for(const auto& chunk : chunks) {
 		array<unsigned int, blocks_per_chunk> block_render_data;
+		unsigned int block_count = 0;
 		for(size_t block_idx = 0; block_idx < blocks_per_chunk; block_idx++) {
 			block_render_data[block_idx] = remap_material(chunk[block_idx].material);
+			if(chunk[block_idx].material != BLOCK_MATERIAL::NONE) block_count++;
 		}
+		chunk_block_counts[chunk_counter] = block_count;
 		render_chunks.emplace_back(float3(chunk_counter % chunk_count.x,
 										  chunk_counter / (chunk_count.x * chunk_count.z),
 										  (chunk_counter / chunk_count.x) % chunk_count.z) * float(chunk_extent),
 								   block_render_data);
+		update_render_bounds((unsigned int)chunk_counter);
 		chunk_counter++;
 	}
+	create_indirect_render_data();
+	
+	// chunks have been moved -> recompute all neighbor flags, the pathfinding data and the chunk meshes
+	rebuild_neighbor_flags();
+	pf->rebuild(*this);
+	mesher->rebuild(*this);
 	
 	// for convenience, initialize the lowest layer of new chunks (@y=0) with indestructible blocks
 	if(live_resize) {
@@ -597,6 +740,125 @@ const vector<sb_map::chunk_render_data>& sb_map::get_render_chunks() const {
 	return render_chunks;
 }
 
+void sb_map::update_render_instances() {
+	array<unsigned int, blocks_per_chunk> instances;
+	for(unsigned int chunk_index = 0, count = (unsigned int)render_chunks.size(); chunk_index < count; chunk_index++) {
+		chunk_render_data& crd(render_chunks[chunk_index]);
+		if(!crd.instances_dirty) continue;
+		crd.instances_dirty = false;
+		
+		// visible blocks are added from the front, fully culled blocks from the back
+		size_t front = 0, back = blocks_per_chunk;
+		for(unsigned int block_idx = 0; block_idx < blocks_per_chunk; block_idx++) {
+			const unsigned int& data(crd.data[block_idx]);
+			if((data & 0x7FFFu) == 0) continue;
+			if((data >> 16u) != (unsigned int)BLOCK_FACE::ALL) instances[front++] = block_idx;
+			else instances[--back] = block_idx;
+		}
+		move(instances.begin() + (ptrdiff_t)back, instances.end(), instances.begin() + (ptrdiff_t)front);
+		crd.visible_instance_count = front;
+		crd.instance_count = front + (blocks_per_chunk - back);
+		if(crd.instance_count == 0) continue;
+		
+		glBindBuffer(GL_UNIFORM_BUFFER, crd.instance_ubo);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, (GLsizeiptr)(crd.instance_count * sizeof(unsigned int)), &instances[0]);
+		
+		if(indirect_instance_buffer != 0) {
+			const unsigned int chunk_bits(chunk_index << instance_chunk_shift);
+			for(size_t i = 0; i < crd.instance_count; i++) {
+				instances[i] |= chunk_bits;
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, indirect_instance_buffer);
+			glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(chunk_index * blocks_per_chunk * sizeof(unsigned int)),
+							(GLsizeiptr)(crd.instance_count * sizeof(unsigned int)), &instances[0]);
+		}
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	if(indirect_instance_buffer != 0) glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool sb_map::is_indirect_rendering_supported() {
+	// glMultiDrawElementsIndirect + base instance (the chunk is selected through the base instance)
+	static const bool supported(exts->is_ext_supported("GL_ARB_multi_draw_indirect") &&
+								exts->is_ext_supported("GL_ARB_base_instance"));
+	return supported;
+}
+
+bool sb_map::has_indirect_render_data() const {
+	return (indirect_instance_buffer != 0);
+}
+
+GLuint sb_map::get_block_data_texture() const {
+	return indirect_data_texture;
+}
+
+GLuint sb_map::get_instance_buffer() const {
+	return indirect_instance_buffer;
+}
+
+void sb_map::create_indirect_render_data() {
+	delete_indirect_render_data();
+	if(render_chunks.empty() || !is_indirect_rendering_supported()) return;
+	
+	const size_t total_block_count(render_chunks.size() * blocks_per_chunk);
+	GLint max_texture_buffer_size = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texture_buffer_size);
+	if(total_block_count > (size_t)max_texture_buffer_size) {
+		a2e_debug("map is too large for a texture buffer (%u > %u texels), drawing chunks separately",
+				  total_block_count, max_texture_buffer_size);
+		return;
+	}
+	
+	vector<unsigned int> block_data;
+	block_data.reserve(total_block_count);
+	for(const auto& crd : render_chunks) {
+		block_data.insert(block_data.end(), crd.data.begin(), crd.data.end());
+	}
+	glGenBuffers(1, &indirect_data_buffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, indirect_data_buffer);
+	glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)(total_block_count * sizeof(unsigned int)), &block_data[0], GL_DYNAMIC_DRAW);
+	glGenTextures(1, &indirect_data_texture);
+	glBindTexture(GL_TEXTURE_BUFFER, indirect_data_texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, indirect_data_buffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	
+	// note: filled by update_render_instances (all chunks are dirty after a resize)
+	glGenBuffers(1, &indirect_instance_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, indirect_instance_buffer);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(total_block_count * sizeof(unsigned int)), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void sb_map::delete_indirect_render_data() {
+	if(indirect_data_texture != 0 && glIsTexture(indirect_data_texture)) glDeleteTextures(1, &indirect_data_texture);
+	if(indirect_data_buffer != 0 && glIsBuffer(indirect_data_buffer)) glDeleteBuffers(1, &indirect_data_buffer);
+	if(indirect_instance_buffer != 0 && glIsBuffer(indirect_instance_buffer)) glDeleteBuffers(1, &indirect_instance_buffer);
+	indirect_data_texture = 0;
+	indirect_data_buffer = 0;
+	indirect_instance_buffer = 0;
+}
+
+void sb_map::update_render_bounds(const unsigned int& chunk_index) {
+	chunk_render_data& crd(render_chunks[chunk_index]);
+	uint3 bmin((unsigned int)chunk_extent), bmax(0u);
+	bool empty = true;
+	for(unsigned int block_idx = 0; block_idx < blocks_per_chunk; block_idx++) {
+		if(chunks[chunk_index][block_idx].material == BLOCK_MATERIAL::NONE) continue;
+		const uint3 local_position(block_index_to_position(block_idx));
+		bmin.min(local_position);
+		bmax.max(local_position);
+		empty = false;
+	}
+	if(empty) {
+		crd.content_min = crd.offset;
+		crd.content_max = crd.offset;
+		return;
+	}
+	crd.content_min = crd.offset + float3(bmin);
+	crd.content_max = crd.offset + float3(bmax + 1u);
+}
+
 void sb_map::set_name(const string& name_) {
 	name = name_;
 }
@@ -658,10 +920,10 @@ rigid_body* sb_map::make_dynamic(const unsigned int& chunk_index, const unsigned
 	
 	// remove from static bodies list (and add to dynamic one), before we update all data
 	static_bodies[chunk_index].erase(block_index);
-	dynamic_bodies.insert(make_pair(body, chunks[chunk_index][block_index].material));
+	add_dynamic_body(body, chunks[chunk_index][block_index].material);
 	update(chunk_index, sb_map::block_index_to_position(block_index), BLOCK_MATERIAL::NONE);
-	body->get_body()->setActivationState(DISABLE_DEACTIVATION);
-	body->get_body()->setSleepingThresholds(0.0f, 0.0f);
+	// let settled blocks fall asleep (they are woken up again by contacts, the weapon or nearby block changes)
+	body->get_body()->setSleepingThresholds(0.4f, 0.5f);
 	
 	pc->make_dynamic(*body, 100.0f);
 	
@@ -688,26 +950,73 @@ rigid_body* sb_map::resolve_dynamic(const uint3& global_position) {
 }
 
 const vector<ai_entity*>& sb_map::get_ai_entities() const {
-	return entities;
+	return ais.get_entities();
 }
 
-void sb_map::update_dynamic_render_data() {
-	if(dynamic_bodies.empty()) return;
+const ai_store& sb_map::get_ai_store() const {
+	return ais;
+}
+
+void sb_map::add_dynamic_body(rigid_body* body, const BLOCK_MATERIAL& mat) {
+	const auto iter = dynamic_bodies.insert(make_pair(body, mat));
+	if(!iter.second) return;
 	
-	dynamic_render_data_size = 0;
-	for(const auto& body : dynamic_bodies) {
-		if(body.second == BLOCK_MATERIAL::NONE ||
-		   body.second == BLOCK_MATERIAL::__PLACEHOLDER_0 ||
-		   body.second == BLOCK_MATERIAL::__PLACEHOLDER_1 ||
-		   body.second == BLOCK_MATERIAL::__PLACEHOLDER_2 ||
-		   body.second == BLOCK_MATERIAL::__PLACEHOLDER_3) {
+	// note: __MAX_BLOCK_MATERIAL forces an initial matrix update
+	dynamic_render_slot_indices.insert(make_pair(body, dynamic_render_slots.size()));
+	dynamic_render_slots.emplace_back(dynamic_render_slot {
+		body,
+		&iter.first->second,
+		BLOCK_MATERIAL::__MAX_BLOCK_MATERIAL,
+		float3(0.0f)
+	});
+	dynamic_render_data.emplace_back();
+}
+
+void sb_map::remove_dynamic_body(rigid_body* body) {
+	const auto slot_iter = dynamic_render_slot_indices.find(body);
+	if(slot_iter != dynamic_render_slot_indices.end()) {
+		// move the last slot into the freed one, so that all slots stay tightly packed
+		const size_t idx = slot_iter->second, last_idx = dynamic_render_slots.size() - 1;
+		dynamic_render_slot_indices.erase(slot_iter);
+		if(idx != last_idx) {
+			dynamic_render_slots[idx] = dynamic_render_slots[last_idx];
+			dynamic_render_slots[idx].rendered_material = BLOCK_MATERIAL::__MAX_BLOCK_MATERIAL;
+			dynamic_render_slot_indices[dynamic_render_slots[idx].body] = idx;
+		}
+		dynamic_render_slots.pop_back();
+		dynamic_render_data.pop_back();
+	}
+	dynamic_bodies.erase(body);
+}
+
+void sb_map::update_dynamic_render_data() {
+	// only rewrite the matrices of bodies that have moved or changed their material/scale since the last update
+	// (note: hidden bodies keep their slot and are remapped to material 0, which is culled in the shader)
+	const size_t slot_count = dynamic_render_slots.size();
+	for(size_t i = 0; i < slot_count; i++) {
+		dynamic_render_slot& slot(dynamic_render_slots[i]);
+		const BLOCK_MATERIAL material(*slot.material);
+		const float3& scale(slot.body->get_scale());
+		if(!slot.body->get_body()->isActive() &&
+		   material == slot.rendered_material &&
+		   (scale == slot.rendered_scale).all()) {
 			continue;
 		}
-		matrix4f& mat(dynamic_render_data[dynamic_render_data_size++]);
-		const btTransform& transform(body.first->get_body()->getWorldTransform());
+		slot.rendered_material = material;
+		slot.rendered_scale = scale;
+		if(dynamic_dirty_min == dynamic_dirty_max) {
+			dynamic_dirty_min = i;
+			dynamic_dirty_max = i + 1;
+		}
+		else {
+			dynamic_dirty_min = std::min(dynamic_dirty_min, i);
+			dynamic_dirty_max = std::max(dynamic_dirty_max, i + 1);
+		}
+		
+		matrix4f& mat(dynamic_render_data[i]);
+		const btTransform& transform(slot.body->get_body()->getWorldTransform());
 		const btMatrix3x3& basis(transform.getBasis());
 		const btVector3& origin(transform.getOrigin());
-		const float3& scale(body.first->get_scale());
 		
 		mat[0] = basis[0][0];
 		mat[1] = basis[1][0];
@@ -739,16 +1048,48 @@ void sb_map::update_dynamic_render_data() {
 		mat[13] = origin.y();
 		mat[14] = origin.z();
 		
-		mat[15] = (float)remap_material(body.second);
+		mat[15] = (float)remap_material(material);
 	}
 	
-	glBindBuffer(GL_UNIFORM_BUFFER, dynamic_bodies_ubo);
-	glBufferSubData(GL_UNIFORM_BUFFER, 0, dynamic_render_data_size * sizeof(matrix4f), &dynamic_render_data[0]);
+	// grow the ubo batches if necessary
+	const size_t batch_count = (slot_count + dynamic_batch_size - 1) / dynamic_batch_size;
+	while(dynamic_bodies_ubos.size() < batch_count) {
+		GLuint ubo = 0;
+		glGenBuffers(1, &ubo);
+		glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+		glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)(dynamic_batch_size * sizeof(matrix4f)), nullptr, GL_DYNAMIC_DRAW);
+		dynamic_bodies_ubos.push_back(ubo);
+	}
+	
+	// upload the dirty range (split at batch boundaries)
+	dynamic_dirty_max = std::min(dynamic_dirty_max, slot_count);
+	if(dynamic_dirty_min < dynamic_dirty_max) {
+		const size_t last_batch = (dynamic_dirty_max - 1) / dynamic_batch_size;
+		for(size_t batch = dynamic_dirty_min / dynamic_batch_size; batch <= last_batch; batch++) {
+			const size_t batch_start = batch * dynamic_batch_size;
+			const size_t range_min = std::max(dynamic_dirty_min, batch_start);
+			const size_t range_max = std::min(dynamic_dirty_max, batch_start + dynamic_batch_size);
+			glBindBuffer(GL_UNIFORM_BUFFER, dynamic_bodies_ubos[batch]);
+			glBufferSubData(GL_UNIFORM_BUFFER,
+							(GLintptr)((range_min - batch_start) * sizeof(matrix4f)),
+							(GLsizeiptr)((range_max - range_min) * sizeof(matrix4f)),
+							&dynamic_render_data[range_min]);
+		}
+	}
 	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	dynamic_dirty_min = 0;
+	dynamic_dirty_max = 0;
+	
+	dynamic_render_batches.clear();
+	for(size_t batch = 0; batch < batch_count; batch++) {
+		const size_t batch_start = batch * dynamic_batch_size;
+		dynamic_render_batches.emplace_back(dynamic_bodies_ubos[batch],
+											std::min(dynamic_batch_size, slot_count - batch_start));
+	}
 }
 
-const pair<GLuint, size_t> sb_map::get_dynamic_render_data() const {
-	return make_pair(dynamic_bodies_ubo, dynamic_render_data_size);
+const vector<pair<GLuint, size_t>>& sb_map::get_dynamic_render_data() const {
+	return dynamic_render_batches;
 }
 
 const unordered_map<rigid_body*, BLOCK_MATERIAL>& sb_map::get_dynamic_bodies() const {
@@ -790,31 +1131,8 @@ bool sb_map::event_handler(EVENT_TYPE type, shared_ptr<event_object> obj) {
 			return false;
 		}
 		
-		// get blocks in a 5x7x5 box surrounding the player
-		// .....
-		// .....
-		// ..x..
-		// ..X..
-		// ..X..
-		// .....
-		// .....
-		static const int3 entity_offset(2, 2, 2);
-		static array<array<array<block_data, 5>, 7>, 5> entity_blocks;
-		const int3 ientity_pos(entity_pos);
-		for(size_t x = 0; x < entity_blocks.size(); x++) {
-			for(size_t y = 0; y < entity_blocks[x].size(); y++) {
-				for(size_t z = 0; z < entity_blocks[x][y].size(); z++) {
-					const int3 pos(ientity_pos - entity_offset + int3(int(x), int(y), int(z)));
-					if(is_valid_position(pos)) {
-						entity_blocks[x][y][z].material = get_block(pos).material;
-					}
-					else entity_blocks[x][y][z].material = BLOCK_MATERIAL::NONE;
-				}
-			}
-		}
-		
 		// check block type of the block the player is currently in (note: only checks the lowest player block!)
-		const BLOCK_MATERIAL mat(entity_blocks[entity_offset.x][entity_offset.y][entity_offset.z].material);
+		const BLOCK_MATERIAL mat(get_block(entity_pos).material);
 		if(entity == ge) {
 			switch(mat) {
 				case BLOCK_MATERIAL::ACID:
@@ -825,15 +1143,13 @@ bool sb_map::event_handler(EVENT_TYPE type, shared_ptr<event_object> obj) {
 			}
 			
 			// check for map change
-			for(const auto& ml : map_links) {
-				if(!ml->enabled) continue;
-				for(const auto& pos : ml->positions) {
-					if(pos.x == entity_pos.x && pos.y == entity_pos.y && pos.z == entity_pos.z) {
-						map_change = { true, ml };
-						break;
-					}
+			// note: multiple map links may share a position -> use the first enabled one
+			const auto ml_range = map_link_positions.equal_range(pack_position(entity_pos));
+			for(auto ml_iter = ml_range.first; ml_iter != ml_range.second; ml_iter++) {
+				if(ml_iter->second->enabled) {
+					map_change = { true, ml_iter->second };
+					break;
 				}
-				if(map_change.first) break;
 			}
 		} else {
 			switch(mat) {
@@ -846,61 +1162,90 @@ bool sb_map::event_handler(EVENT_TYPE type, shared_ptr<event_object> obj) {
 		
 		// check block type of the block the player stands on
 		if(entity_pos.y > 0) {
-			const BLOCK_MATERIAL below_mat(entity_blocks[entity_offset.x][entity_offset.y - 1][entity_offset.z].material);
+			const BLOCK_MATERIAL below_mat(get_block(entity_pos - uint3(0, 1, 0)).material);
 			switch(below_mat) {
 				default:
 					break;
 			}
 		}
 		
-		// magnet check
-		static const array<int3, 14> magnet_offsets {
-			{
-				int3(-1, 0, 0), int3(1, 0, 0), int3(0, 0, -1), int3(0, 0, 1),
-				int3(-1, 1, 0), int3(1, 1, 0), int3(0, 1, -1), int3(0, 1, 1),
-				int3(-1, 2, 0), int3(1, 2, 0), int3(0, 2, -1), int3(0, 2, 1),
-				int3(0, -1, 0), int3(0, 3, 0),
-			}
-		};
 		entity->reset_speed();
 		entity->reset_jump_strength();
-		for(const auto& magnet_offset : magnet_offsets) {
-			if(entity_blocks[magnet_offset.x + entity_offset.x][magnet_offset.y + entity_offset.y][magnet_offset.z + entity_offset.z].material == BLOCK_MATERIAL::MAGNET) {
-				entity->set_speed(1.0f);
-				entity->set_jump_strength(1.0f);
-				if(entity == ge) play_sound("MAGNET", ientity_pos + magnet_offset);
+		
+		// no magnet or spring within reach -> nothing else to do
+		const unsigned char flags(get_neighbor_flags(entity_pos));
+		if(flags == (unsigned char)NEIGHBOR_FLAG::NONE) return true;
+		
+		// get blocks in a 5x7x5 box surrounding the player
+		// .....
+		// .....
+		// ..x..
+		// ..X..
+		// ..X..
+		// .....
+		// .....
+		static const int3 entity_offset(2, 2, 2);
+		neighborhood_view<5, 7, 5> entity_blocks;
+		const int3 ientity_pos(entity_pos);
+		get_neighborhood(ientity_pos - entity_offset, entity_blocks);
+		
+		// magnet check
+		if((flags & (unsigned char)NEIGHBOR_FLAG::MAGNET) != 0) {
+			for(const auto& magnet_offset : magnet_offsets) {
+				if(entity_blocks.at(magnet_offset + entity_offset) == BLOCK_MATERIAL::MAGNET) {
+					entity->set_speed(1.0f);
+					entity->set_jump_strength(1.0f);
+					if(entity == ge) play_sound("MAGNET", ientity_pos + magnet_offset);
+				}
 			}
 		}
 		
 		// handling spring blocks is slightly more complicated (blocks in a 5x7x5 box must be checked)
-		static const array<int3, 28> spring_block_offsets {
-			{
-				int3(-2, 0, 0), int3(-1, 0, 0), int3(1, 0, 0), int3(2, 0, 0),
-				int3(0, 0, -2), int3(0, 0, -1), int3(0, 0, 1), int3(0, 0, 2),
-				int3(-2, 1, 0), int3(-1, 1, 0), int3(1, 1, 0), int3(2, 1, 0),
-				int3(0, 1, -2), int3(0, 1, -1), int3(0, 1, 1), int3(0, 1, 2),
-				int3(-2, 2, 0), int3(-1, 2, 0), int3(1, 2, 0), int3(2, 2, 0),
-				int3(0, 2, -2), int3(0, 2, -1), int3(0, 2, 1), int3(0, 2, 2),
-				int3(0, -2, 0), int3(0, -1, 0), int3(0, 1, 0), int3(0, 2, 0),
-			}
-		};
-		const int3 bounds(chunk_count * chunk_extent);
-		for(const auto& spring_block : spring_block_offsets) {
-			if(entity_blocks[spring_block.x + entity_offset.x][spring_block.y + entity_offset.y][spring_block.z + entity_offset.z].material == BLOCK_MATERIAL::SPRING) {
-				const int3 spring_pos(entity_pos + spring_block);
-				const int3 spring_dir(-((spring_block.x == 0 && spring_block.z == 0) ?
-										int3(0, spring_block.y > 0 ? 1 : -1, 0) :
-										((spring_block.x == 0) ? int3(0, 0, spring_block.z > 0 ? 1 : -1) :
-										 int3(spring_block.x > 0 ? 1 : -1, 0, 0))));
-				// check if spring can extend into this direction (-> 2 NONE blocks)
-				if(is_valid_position(spring_pos + spring_dir) && is_valid_position(spring_pos + spring_dir * 2) &&
-				   get_block(spring_pos + spring_dir).material == BLOCK_MATERIAL::NONE &&
-				   get_block(spring_pos + spring_dir * 2).material == BLOCK_MATERIAL::NONE) {
-					add_spring(spring_pos, spring_dir);
+		if((flags & (unsigned char)NEIGHBOR_FLAG::SPRING) != 0) {
+			for(const auto& spring_block : spring_block_offsets) {
+				if(entity_blocks.at(spring_block + entity_offset) == BLOCK_MATERIAL::SPRING) {
+					const int3 spring_pos(entity_pos + spring_block);
+					const int3 spring_dir(-((spring_block.x == 0 && spring_block.z == 0) ?
+											int3(0, spring_block.y > 0 ? 1 : -1, 0) :
+											((spring_block.x == 0) ? int3(0, 0, spring_block.z > 0 ? 1 : -1) :
+											 int3(spring_block.x > 0 ? 1 : -1, 0, 0))));
+					// check if spring can extend into this direction (-> 2 NONE blocks)
+					if(is_valid_position(spring_pos + spring_dir) && is_valid_position(spring_pos + spring_dir * 2) &&
+					   get_block(spring_pos + spring_dir).material == BLOCK_MATERIAL::NONE &&
+					   get_block(spring_pos + spring_dir * 2).material == BLOCK_MATERIAL::NONE) {
+						add_spring(spring_pos, spring_dir);
+					}
 				}
 			}
 		}
 		
+		return true;
+	} else if (type == EVENT_TYPE::SPRING_CHANGE) {
+		const shared_ptr<spring_change_event>& spring_evt = (shared_ptr<spring_change_event>&)obj;
+		const auto iter = find(begin(springs), end(springs), spring_evt->spring);
+		if(iter == end(springs)) return true;
+		kinematic_spring* sp = *iter;
+		switch(spring_evt->state) {
+			case SPRING_STATE::RETRACTING:
+				play_sound("SPRING", sp->get_position());
+				break;
+			case SPRING_STATE::RETRACTED:
+				// fully retracted and retraction period is over -> delete
+				springs.erase(iter);
+				remove_dynamic_body(sp->get_body());
+				pc->remove_kinematic_spring(sp);
+				break;
+			default: break;
+		}
+		return true;
+	} else if (type == EVENT_TYPE::WEIGHT_SENSOR_CHANGE) {
+		const shared_ptr<weight_sensor_change_event>& sensor_evt = (shared_ptr<weight_sensor_change_event>&)obj;
+		for(const auto& trgr : triggers) {
+			if(trgr->type != TRIGGER_TYPE::WEIGHT || trgr->state.sensor != sensor_evt->sensor) continue;
+			if(sensor_evt->triggered) trgr->activate(this);
+			else trgr->deactivate(this);
+			break;
+		}
 		return true;
 	}
 	return false;
@@ -909,22 +1254,13 @@ bool sb_map::event_handler(EVENT_TYPE type, shared_ptr<event_object> obj) {
 void sb_map::add_spring(const uint3& position, const float3& direction) {
 	// check if a spring for that position is already active
 	for(const auto& sp : springs) {
-		if((sp->position == position).all()) return;
+		if((sp->get_position() == position).all()) return;
 	}
 	
-	//
-	rigid_info* sp_info = &pc->add_rigid_info<physics_controller::SHAPE::BOX>(0.0f, float3(0.5f));
-	rigid_body* sp = &pc->add_rigid_body(*sp_info, float3(position) + 0.5f);
-	dynamic_bodies.insert(make_pair(sp, BLOCK_MATERIAL::SPRING));
-	springs.emplace_back(new spring {
-		position,
-		direction,
-		sp_info,
-		sp,
-		0.0f,
-		1.0f,
-		SDL_GetTicks(),
-	});
+	// the spring animation itself is handled by the physics controller
+	kinematic_spring* sp = pc->add_kinematic_spring(position, direction);
+	add_dynamic_body(sp->get_body(), BLOCK_MATERIAL::SPRING);
+	springs.emplace_back(sp);
 	
 	play_sound("SPRING", position);
 }
@@ -944,6 +1280,7 @@ void sb_map::remove_background_music() {
 
 void sb_map::add_sound(audio_3d* sound) {
 	env_sounds.insert(sound);
+	sound_symbols.insert(symbol_table::intern(sound->get_identifier()), sound);
 }
 
 const set<audio_3d*>& sb_map::get_sounds() const {
@@ -951,12 +1288,11 @@ const set<audio_3d*>& sb_map::get_sounds() const {
 }
 
 audio_3d* sb_map::get_sound(const string& identifier) const {
-	for(const auto& snd : env_sounds) {
-		if(snd->get_identifier() == identifier) {
-			return snd;
-		}
-	}
-	return nullptr;
+	return get_sound(symbol_table::lookup(identifier));
+}
+
+audio_3d* sb_map::get_sound(const symbol& sym) const {
+	return sound_symbols.get(sym);
 }
 
 void sb_map::remove_sound(audio_3d* sound) {
@@ -964,6 +1300,7 @@ void sb_map::remove_sound(audio_3d* sound) {
 	if(iter != end(env_sounds)) {
 		const string identifier(sound->get_identifier());
 		env_sounds.erase(iter);
+		sound_symbols.erase(symbol_table::lookup(identifier), sound);
 		if(!ac->delete_audio_source(identifier)) {
 			a2e_error("failed to delete audio source \"%s\"!", identifier);
 		}
@@ -985,16 +1322,46 @@ const vector<unordered_map<unsigned int, light*>>& sb_map::get_lights() const {
 
 void sb_map::add_map_link(map_link* ml) {
 	map_links.push_back(ml);
+	map_link_symbols.insert(symbol_table::intern(ml->identifier), ml);
+	for(const auto& pos : ml->positions) {
+		map_link_positions.insert(make_pair(pack_position(pos), ml));
+	}
 }
 
 void sb_map::remove_map_link(map_link* ml) {
 	const auto iter = find(begin(map_links), end(map_links), ml);
 	if(iter != end(map_links)) {
 		map_links.erase(iter);
+		unregister_symbol(map_link_symbols, map_links, ml);
+		for(const auto& pos : ml->positions) {
+			const auto range = map_link_positions.equal_range(pack_position(pos));
+			for(auto pos_iter = range.first; pos_iter != range.second; pos_iter++) {
+				if(pos_iter->second == ml) {
+					map_link_positions.erase(pos_iter);
+					break;
+				}
+			}
+		}
 		delete ml;
 	}
 }
 
+void sb_map::set_map_link_positions(map_link* ml, const vector<uint3>& positions) {
+	for(const auto& pos : ml->positions) {
+		const auto range = map_link_positions.equal_range(pack_position(pos));
+		for(auto pos_iter = range.first; pos_iter != range.second; pos_iter++) {
+			if(pos_iter->second == ml) {
+				map_link_positions.erase(pos_iter);
+				break;
+			}
+		}
+	}
+	ml->positions = positions;
+	for(const auto& pos : ml->positions) {
+		map_link_positions.insert(make_pair(pack_position(pos), ml));
+	}
+}
+
 const pair<bool, sb_map::map_link*>& sb_map::is_map_change() const {
 	return map_change;
 }
@@ -1003,23 +1370,30 @@ const vector<sb_map::map_link*>& sb_map::get_map_links() const {
 	return map_links;
 }
 
+void sb_map::set_map_link_identifier(map_link* ml, const string& identifier) {
+	unregister_symbol(map_link_symbols, map_links, ml);
+	ml->identifier = identifier;
+	map_link_symbols.insert(symbol_table::intern(identifier), ml);
+}
+
 sb_map::map_link* sb_map::get_map_link(const string& identifier) const {
-	for(const auto& ml : map_links) {
-		if(ml->identifier == identifier) {
-			return ml;
-		}
-	}
-	return nullptr;
+	return get_map_link(symbol_table::lookup(identifier));
+}
+
+sb_map::map_link* sb_map::get_map_link(const symbol& sym) const {
+	return map_link_symbols.get(sym);
 }
 
 void sb_map::add_ai_waypoint(sb_map::ai_waypoint* wp) {
 	ai_waypoints.push_back(wp);
+	ai_waypoint_symbols.insert(symbol_table::intern(wp->identifier), wp);
 }
 
 void sb_map::remove_ai_waypoint(sb_map::ai_waypoint* wp) {
 	const auto iter = find(begin(ai_waypoints), end(ai_waypoints), wp);
 	if(iter == ai_waypoints.end()) return;
 	ai_waypoints.erase(iter);
+	unregister_symbol(ai_waypoint_symbols, ai_waypoints, wp);
 	delete wp;
 }
 
@@ -1027,13 +1401,26 @@ const vector<sb_map::ai_waypoint*>& sb_map::get_ai_waypoints() const {
 	return ai_waypoints;
 }
 
+void sb_map::set_ai_waypoint_identifier(ai_waypoint* wp, const string& identifier) {
+	unregister_symbol(ai_waypoint_symbols, ai_waypoints, wp);
+	wp->identifier = identifier;
+	ai_waypoint_symbols.insert(symbol_table::intern(identifier), wp);
+}
+
 sb_map::ai_waypoint* sb_map::get_ai_waypoint(const string& identifier) const {
-	for(const auto& wp : ai_waypoints) {
-		if(wp->identifier == identifier) {
-			return wp;
-		}
-	}
-	return nullptr;
+	return get_ai_waypoint(symbol_table::lookup(identifier));
+}
+
+sb_map::ai_waypoint* sb_map::get_ai_waypoint(const symbol& sym) const {
+	return ai_waypoint_symbols.get(sym);
+}
+
+pathfinder* sb_map::get_pathfinder() const {
+	return pf;
+}
+
+chunk_mesher* sb_map::get_chunk_mesher() const {
+	return mesher;
 }
 
 ai_entity* sb_map::add_ai_entity(const uint3& position) {
@@ -1042,7 +1429,9 @@ ai_entity* sb_map::add_ai_entity(const uint3& position) {
 		return nullptr;
 	}
 	ai_entity* entity = new ai_entity(float3(position) + 0.5f);
-	entities.push_back(entity);
+	pc->lock();
+	ais.add(entity);
+	pc->unlock();
 	return entity;
 }
 
@@ -1056,6 +1445,8 @@ bool sb_map::is_valid_position(const uint3& global_position) const {
 
 void sb_map::add_trigger(sb_map::trigger* trgr) {
 	triggers.emplace_back(trgr);
+	trigger_symbols.insert(symbol_table::intern(trgr->identifier), trgr);
+	trigger_positions.insert(make_pair(pack_position(trgr->position), trgr));
 	if(!trgr->on_load.empty()) {
 		trgr->state.active = true;
 		if(trgr->sub_type == TRIGGER_SUB_TYPE::TIMED) {
@@ -1066,7 +1457,7 @@ void sb_map::add_trigger(sb_map::trigger* trgr) {
 	
 	switch(trgr->type) {
 		case TRIGGER_TYPE::WEIGHT: {
-			trgr->state.slider = pc->add_weight_slider(trgr->position, 0.25f, trgr->weight);
+			trgr->state.sensor = pc->add_weight_sensor(trgr->position, trgr->weight);
 		}
 		break;
 		default: break;
@@ -1077,29 +1468,77 @@ void sb_map::remove_trigger(sb_map::trigger* trgr) {
 	const auto iter = find(begin(triggers), end(triggers), trgr);
 	if(iter != end(triggers)) {
 		triggers.erase(iter);
+		unregister_symbol(trigger_symbols, triggers, trgr);
+		const auto range = trigger_positions.equal_range(pack_position(trgr->position));
+		for(auto pos_iter = range.first; pos_iter != range.second; pos_iter++) {
+			if(pos_iter->second == trgr) {
+				trigger_positions.erase(pos_iter);
+				break;
+			}
+		}
+		if(trgr->type == TRIGGER_TYPE::WEIGHT) {
+			pc->remove_weight_sensor(trgr->state.sensor);
+		}
 		delete trgr;
 	}
 }
 
+void sb_map::move_trigger(sb_map::trigger* trgr, const uint3& position) {
+	const auto range = trigger_positions.equal_range(pack_position(trgr->position));
+	for(auto pos_iter = range.first; pos_iter != range.second; pos_iter++) {
+		if(pos_iter->second == trgr) {
+			trigger_positions.erase(pos_iter);
+			break;
+		}
+	}
+	trgr->position = position;
+	trigger_positions.insert(make_pair(pack_position(position), trgr));
+}
+
 const vector<sb_map::trigger*> sb_map::get_triggers() const {
 	return triggers;
 }
 
-sb_map::trigger* sb_map::get_trigger(const string& identifier) const {
-	for(const auto& trgr : triggers) {
-		if(trgr->identifier == identifier) {
-			return trgr;
-		}
+pair<sb_map::trigger_position_map::const_iterator, sb_map::trigger_position_map::const_iterator> sb_map::get_triggers(const uint3& position) const {
+	return trigger_positions.equal_range(pack_position(position));
+}
+
+sb_map::trigger* sb_map::get_first_trigger(const uint3& position) const {
+	const auto range = trigger_positions.equal_range(pack_position(position));
+	if(range.first == range.second) return nullptr;
+	
+	// multiple triggers at this position (rare) -> the position index is unordered, so resolve the map order
+	trigger* first_trgr = range.first->second;
+	if(next(range.first) == range.second) return first_trgr;
+	auto first_iter = find(begin(triggers), end(triggers), first_trgr);
+	for(auto iter = next(range.first); iter != range.second; iter++) {
+		const auto trgr_iter = find(begin(triggers), first_iter, iter->second);
+		if(trgr_iter != first_iter) first_iter = trgr_iter;
 	}
-	return nullptr;
+	return *first_iter;
+}
+
+void sb_map::set_trigger_identifier(sb_map::trigger* trgr, const string& identifier) {
+	unregister_symbol(trigger_symbols, triggers, trgr);
+	trgr->identifier = identifier;
+	trigger_symbols.insert(symbol_table::intern(identifier), trgr);
+}
+
+sb_map::trigger* sb_map::get_trigger(const string& identifier) const {
+	return get_trigger(symbol_table::lookup(identifier));
+}
+
+sb_map::trigger* sb_map::get_trigger(const symbol& sym) const {
+	return trigger_symbols.get(sym);
 }
 
 void sb_map::handle_block_click(const pair<uint3, BLOCK_FACE>& clicked_block, bool& activated) {
 	// check push button triggers
-	for(auto& trgr : triggers) {
+	const auto range = trigger_positions.equal_range(pack_position(clicked_block.first));
+	for(auto iter = range.first; iter != range.second; iter++) {
+		trigger* trgr = iter->second;
 		if(trgr->type == TRIGGER_TYPE::PUSH &&
-		   ((unsigned int)clicked_block.second & (unsigned int)trgr->facing) != 0 &&
-		   (clicked_block.first == trgr->position).all()) {
+		   ((unsigned int)clicked_block.second & (unsigned int)trgr->facing) != 0) {
 			trgr->state.active ? trgr->deactivate(this) : trgr->activate(this);
 			activated = true;
 		}
@@ -1107,20 +1546,43 @@ void sb_map::handle_block_click(const pair<uint3, BLOCK_FACE>& clicked_block, bo
 }
 
 void sb_map::add_spawner(const uint3& position) {
-	spawners.emplace_back(new spawner {
+	spawner* spwn = new spawner {
 		position,
 		1,
-		set<ai_entity*> {}
-	});
+		set<ai_entity*> {},
+		0x3F, // will be updated right away
+		0
+	};
+	spawners.emplace_back(spwn);
+	spawner_positions.insert(make_pair(pack_position(position), spwn));
+	update_spawner_neighbors(spwn);
+}
+
+void sb_map::update_spawner_neighbors(spawner* spwn) {
+	unsigned char free_neighbors = 0;
+	for(size_t i = 0; i < spawner_offsets.size(); i++) {
+		const int3 pos(int3(spwn->position) + spawner_offsets[i]);
+		if(pos.x < 0 || pos.y < 0 || pos.z < 0 || !is_valid_position(uint3(pos))) continue;
+		if(get_block(uint3(pos)).material == BLOCK_MATERIAL::NONE) {
+			free_neighbors |= (unsigned char)(1u << i);
+		}
+	}
+	
+	// only complain once (when the spawner gets blocked)
+	if(free_neighbors == 0 && spwn->free_neighbors != 0) {
+		a2e_error("no valid spawn position found for spawner @%v!", spwn->position);
+	}
+	spwn->free_neighbors = free_neighbors;
 }
 
 void sb_map::remove_spawner(const uint3& position) {
-	for(auto iter = begin(spawners); iter != end(spawners); iter++) {
-		if(((*iter)->position == position).all()) {
-			spawners.erase(iter);
-			break;
-		}
-	}
+	const auto pos_iter = spawner_positions.find(pack_position(position));
+	if(pos_iter == spawner_positions.end()) return;
+	spawner* spwn = pos_iter->second;
+	spawner_positions.erase(pos_iter);
+	const auto iter = find(begin(spawners), end(spawners), spwn);
+	if(iter != end(spawners)) spawners.erase(iter);
+	delete spwn;
 }
 
 audio_3d* sb_map::play_sound(const string& identifier, const float3& position, const float volume, const bool is_looping, const bool can_be_killed) const {
@@ -1197,19 +1659,71 @@ const float3& sb_map::get_default_light_color() const {
 
 void sb_map::add_light_color_area(sb_map::light_color_area* lca) {
 	light_color_areas.push_back(lca);
+	index_light_color_area(lca);
+	update_light_colors(lca->min_pos, lca->max_pos);
 }
 
 void sb_map::remove_light_color_area(sb_map::light_color_area* lca) {
 	const auto iter = find(begin(light_color_areas), end(light_color_areas), lca);
 	if(iter == end(light_color_areas)) return;
 	light_color_areas.erase(iter);
+	unindex_light_color_area(lca);
+	update_light_colors(lca->min_pos, lca->max_pos);
 	delete lca;
 }
 
+void sb_map::update_light_color_area(light_color_area* lca, const uint3& min_pos, const uint3& max_pos, const float3& color) {
+	const uint3 old_min_pos(lca->min_pos), old_max_pos(lca->max_pos);
+	unindex_light_color_area(lca);
+	lca->min_pos = min_pos;
+	lca->max_pos = max_pos;
+	lca->color = color;
+	index_light_color_area(lca);
+	
+	// recolor everything that was or is now influenced by the area
+	update_light_colors(old_min_pos, old_max_pos);
+	update_light_colors(min_pos, max_pos);
+}
+
 const vector<sb_map::light_color_area*>& sb_map::get_light_color_areas() const {
 	return light_color_areas;
 }
 
+pair<uint3, uint3> sb_map::get_chunk_range(const uint3& min_pos, const uint3& max_pos) const {
+	// note: area bounds may lie one block outside of the map
+	const uint3 max_chunk(chunk_count - 1u);
+	return {
+		uint3::min(min_pos / chunk_extent, max_chunk),
+		uint3::min(max_pos / chunk_extent, max_chunk)
+	};
+}
+
+void sb_map::index_light_color_area(light_color_area* lca) {
+	if(chunk_light_color_areas.empty()) return;
+	const pair<uint3, uint3> range(get_chunk_range(lca->min_pos, lca->max_pos));
+	for(unsigned int cy = range.first.y; cy <= range.second.y; cy++) {
+		for(unsigned int cz = range.first.z; cz <= range.second.z; cz++) {
+			for(unsigned int cx = range.first.x; cx <= range.second.x; cx++) {
+				chunk_light_color_areas[chunk_position_to_index(uint3(cx, cy, cz))].push_back(lca);
+			}
+		}
+	}
+}
+
+void sb_map::unindex_light_color_area(light_color_area* lca) {
+	if(chunk_light_color_areas.empty()) return;
+	const pair<uint3, uint3> range(get_chunk_range(lca->min_pos, lca->max_pos));
+	for(unsigned int cy = range.first.y; cy <= range.second.y; cy++) {
+		for(unsigned int cz = range.first.z; cz <= range.second.z; cz++) {
+			for(unsigned int cx = range.first.x; cx <= range.second.x; cx++) {
+				auto& chunk_lcas = chunk_light_color_areas[chunk_position_to_index(uint3(cx, cy, cz))];
+				const auto iter = find(begin(chunk_lcas), end(chunk_lcas), lca);
+				if(iter != end(chunk_lcas)) chunk_lcas.erase(iter);
+			}
+		}
+	}
+}
+
 float3 sb_map::compute_light_color_for_position(const uint3& global_position) const {
 	const auto is_influenced_by_lca = [](const uint3& pos, const light_color_area& lca) -> bool {
 		if(pos.x >= lca.min_pos.x && pos.x <= lca.max_pos.x &&
@@ -1220,9 +1734,10 @@ float3 sb_map::compute_light_color_for_position(const uint3& global_position) co
 		return false;
 	};
 	
+	// only areas overlapping the chunk of this position can influence it
 	unsigned int lca_count = 0;
 	float3 light_color;
-	for(const auto& lca : light_color_areas) {
+	for(const auto& lca : chunk_light_color_areas[chunk_position_to_index(global_position / chunk_extent)]) {
 		if(is_influenced_by_lca(global_position, *lca)) {
 			light_color += lca->color;
 			lca_count++;
@@ -1248,6 +1763,23 @@ void sb_map::update_light_colors() {
 	}
 }
 
+void sb_map::update_light_colors(const uint3& min_pos, const uint3& max_pos) {
+	if(lights.empty()) return;
+	const pair<uint3, uint3> range(get_chunk_range(min_pos, max_pos));
+	for(unsigned int cy = range.first.y; cy <= range.second.y; cy++) {
+		for(unsigned int cz = range.first.z; cz <= range.second.z; cz++) {
+			for(unsigned int cx = range.first.x; cx <= range.second.x; cx++) {
+				const uint3 chunk_position(cx, cy, cz);
+				for(const auto& li : lights[chunk_position_to_index(chunk_position)]) {
+					const uint3 position(block_index_to_position(li.first) + chunk_position * chunk_extent);
+					if((position < min_pos).any() || (position > max_pos).any()) continue;
+					li.second->set_color(compute_light_color_for_position(position));
+				}
+			}
+		}
+	}
+}
+
 unsigned int sb_map::remap_material(const BLOCK_MATERIAL& mat) {
 	// remap material
 	static const vector<unsigned int> mat_remap {
@@ -1270,23 +1802,57 @@ unsigned int sb_map::remap_material(const BLOCK_MATERIAL& mat) {
 	return mat_remap[(unsigned int)mat];
 }
 
+unsigned int sb_map::block_render_material(const BLOCK_MATERIAL& mat) {
+	// flag if material texture should be flipped horizontally every other y layer
+	static const vector<bool> flip_mat {
+		{
+			false,	// NONE,
+			true,	// INDESTRUCTIBLE,
+			false,	// METAL,
+			false,	// __PLACEHOLDER_0,
+			false,	// MAGNET,
+			false,	// LIGHT,
+			false,	// __PLACEHOLDER_1,
+			false,	// ACID,
+			false,	// __PLACEHOLDER_2,
+			false,	// __PLACEHOLDER_3,
+			false,	// SPRING,
+			false,	// SPAWNER,
+			false,	// __MAX_BLOCK_MATERIAL
+		}
+	};
+	return remap_material(mat) | (flip_mat[(unsigned int)mat] ? render_flip_flag : 0u);
+}
+
 ////////////////////
 // chunk_render_data
 
-sb_map::chunk_render_data::chunk_render_data(const float3& offset_, array<unsigned int, blocks_per_chunk>& render_data) : offset(offset_), ubo(0) {
+sb_map::chunk_render_data::chunk_render_data(const float3& offset_, array<unsigned int, blocks_per_chunk>& render_data) :
+offset(offset_), ubo(0), content_min(offset_), content_max(offset_), instance_ubo(0),
+visible_instance_count(0), instance_count(0), instances_dirty(true), data(render_data.begin(), render_data.end()) {
 	// gen and init (with no culling info):
 	glGenBuffers(1, &ubo);
 	glBindBuffer(GL_UNIFORM_BUFFER, ubo);
 	glBufferData(GL_UNIFORM_BUFFER, blocks_per_chunk * sizeof(unsigned int), &render_data[0], GL_STATIC_DRAW);
+	
+	// instance list (filled by update_render_instances)
+	glGenBuffers(1, &instance_ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, instance_ubo);
+	glBufferData(GL_UNIFORM_BUFFER, blocks_per_chunk * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
 	glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
-sb_map::chunk_render_data::chunk_render_data(chunk_render_data&& crd) : offset(crd.offset), ubo(crd.ubo) {
+sb_map::chunk_render_data::chunk_render_data(chunk_render_data&& crd) :
+offset(crd.offset), ubo(crd.ubo), content_min(crd.content_min), content_max(crd.content_max),
+instance_ubo(crd.instance_ubo), visible_instance_count(crd.visible_instance_count), instance_count(crd.instance_count),
+instances_dirty(crd.instances_dirty), data(move(crd.data)) {
 	crd.ubo = 0;
+	crd.instance_ubo = 0;
 }
 
 sb_map::chunk_render_data::~chunk_render_data() {
 	if(glIsBuffer(ubo)) glDeleteBuffers(1, &ubo);
+	if(glIsBuffer(instance_ubo)) glDeleteBuffers(1, &instance_ubo);
 }
 
 ////////////////////
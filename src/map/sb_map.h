@@ -21,6 +21,8 @@
 #define __SB_MAP_H__
 
 #include "sb_global.h"
+#include "symbol_table.h"
+#include "ai_store.h"
 #include <atomic>
 
 // for convenience and forward-declarability(tm), make these global:
@@ -72,7 +74,10 @@ class a2emodel;
 class a2ematerial;
 class ai_entity;
 class script;
-class weight_slider;
+class weight_sensor;
+class kinematic_spring;
+class pathfinder;
+class chunk_mesher;
 enum class GAME_STATUS;
 class sb_map {
 public:
@@ -102,6 +107,63 @@ public:
 	const chunk& get_chunk(const unsigned int& chunk_index) const;
 	const block_data& get_block(const unsigned int& chunk_index, const unsigned int& block_index) const;
 	const block_data& get_block(const uint3& global_position) const;
+	// amount of non-empty blocks in a chunk
+	unsigned int get_chunk_block_count(const unsigned int& chunk_index) const;
+	
+	// derived per-block flags: set if a special block is within reach of an entity standing in this block
+	enum class NEIGHBOR_FLAG : unsigned char {
+		NONE	= 0,
+		MAGNET	= (1 << 0),
+		SPRING	= (1 << 1),
+	};
+	unsigned char get_neighbor_flags(const uint3& global_position) const;
+	
+	// materials of an axis-aligned box of blocks (stored in X*Z*Y order, like chunks)
+	template <size_t size_x, size_t size_y, size_t size_z> struct neighborhood_view {
+		int3 origin; // global position of the (0, 0, 0) block
+		array<BLOCK_MATERIAL, size_x * size_y * size_z> materials;
+		
+		const BLOCK_MATERIAL& at(const int3& local_position) const {
+			return materials[(size_t(local_position.y) * size_z + size_t(local_position.z)) * size_x + size_t(local_position.x)];
+		}
+		BLOCK_MATERIAL& at(const int3& local_position) {
+			return materials[(size_t(local_position.y) * size_z + size_t(local_position.z)) * size_x + size_t(local_position.x)];
+		}
+	};
+	// fills the view with the materials of the box starting at origin (positions outside of the map are NONE)
+	// note: this copies whole x rows per chunk, so no per-block position -> index conversion is necessary
+	template <size_t size_x, size_t size_y, size_t size_z>
+	void get_neighborhood(const int3& origin, neighborhood_view<size_x, size_y, size_z>& view) const {
+		view.origin = origin;
+		view.materials.fill(BLOCK_MATERIAL::NONE);
+		
+		// clip the box against the map (box_max is exclusive)
+		const int3 box_min(int3::max(origin, int3(0))), box_max(int3::min(origin + int3(size_x, size_y, size_z),
+																		   int3(chunk_count * chunk_extent)));
+		if(box_min.x >= box_max.x || box_min.y >= box_max.y || box_min.z >= box_max.z) return;
+		
+		const int extent(chunk_extent);
+		const int3 min_chunk(box_min / extent), max_chunk((box_max - 1) / extent);
+		for(int cy = min_chunk.y; cy <= max_chunk.y; cy++) {
+			for(int cz = min_chunk.z; cz <= max_chunk.z; cz++) {
+				for(int cx = min_chunk.x; cx <= max_chunk.x; cx++) {
+					const chunk& chnk(chunks[chunk_position_to_index(uint3(cx, cy, cz))]);
+					const int3 chunk_origin(int3(cx, cy, cz) * extent);
+					const int3 copy_min(int3::max(box_min, chunk_origin)), copy_max(int3::min(box_max, chunk_origin + extent));
+					const size_t row_length(size_t(copy_max.x - copy_min.x));
+					for(int y = copy_min.y; y < copy_max.y; y++) {
+						for(int z = copy_min.z; z < copy_max.z; z++) {
+							const block_data* src(&chnk[block_position_to_index(uint3(int3(copy_min.x, y, z) - chunk_origin))]);
+							BLOCK_MATERIAL* dst(&view.at(int3(copy_min.x, y, z) - origin));
+							for(size_t x = 0; x < row_length; x++) {
+								dst[x] = src[x].material;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
 	
 	// block/chunk position and index conversion
 	uint3 chunk_index_to_position(const unsigned int& chunk_index) const {
@@ -121,6 +183,12 @@ public:
 		return block_position.y * (chunk_extent*chunk_extent) + block_position.z * chunk_extent + block_position.x;
 	}
 	bool is_valid_position(const uint3& global_position) const;
+	// packs a global block position into a single key (independent of the map size)
+	static unsigned long long int pack_position(const uint3& global_position) {
+		return ((unsigned long long int)global_position.x |
+				((unsigned long long int)global_position.y << 21ull) |
+				((unsigned long long int)global_position.z << 42ull));
+	}
 	
 	// org map functions
 	void set_name(const string& name);
@@ -149,6 +217,7 @@ public:
 	void update_dynamic(rigid_body* body, const BLOCK_MATERIAL& block_material);
 	
 	const vector<ai_entity*>& get_ai_entities() const;
+	const ai_store& get_ai_store() const;
 	
 	// audio functions
 	void set_background_music(audio_background* bg);
@@ -158,6 +227,7 @@ public:
 	void add_sound(audio_3d* sound);
 	const set<audio_3d*>& get_sounds() const;
 	audio_3d* get_sound(const string& identifier) const;
+	audio_3d* get_sound(const symbol& sym) const;
 	void remove_sound(audio_3d* sound);
 	
 	// lighting functions
@@ -168,12 +238,17 @@ public:
 	};
 	void add_light_color_area(light_color_area* lca);
 	void remove_light_color_area(light_color_area* lca);
+	// modifies the area and only recolors the lights inside its old and new bounds
+	void update_light_color_area(light_color_area* lca, const uint3& min_pos, const uint3& max_pos, const float3& color);
 	const vector<light_color_area*>& get_light_color_areas() const;
 	void update_light_colors();
+	void update_light_colors(const uint3& min_pos, const uint3& max_pos);
 	
 	light* get_light(const uint3& global_position) const;
 	const vector<unordered_map<unsigned int, light*>>& get_lights() const;
 	
+	// light blocks only contribute to positions within their radius -> only chunks within this radius are visited
+	static constexpr float block_light_radius = 16.0f;
 	float light_intensity_for_position(const uint3& global_position) const;
 	
 	// misc functions
@@ -190,9 +265,12 @@ public:
 	};
 	void add_map_link(map_link* ml);
 	void remove_map_link(map_link* ml);
+	void set_map_link_positions(map_link* ml, const vector<uint3>& positions);
+	void set_map_link_identifier(map_link* ml, const string& identifier);
 	const pair<bool, map_link*>& is_map_change() const;
 	const vector<map_link*>& get_map_links() const;
 	map_link* get_map_link(const string& identifier) const;
+	map_link* get_map_link(const symbol& sym) const;
 	
 	void handle_block_click(const pair<uint3, BLOCK_FACE>& clicked_block, bool& activated);
 	
@@ -211,7 +289,7 @@ public:
 		string on_untrigger;
 		
 		// dependent data (oo is overrated):
-		float weight;
+		float weight; // required load on the weight sensor (rigid body mass units, a character weighs 10)
 		float intensity;
 		unsigned int time;
 		
@@ -219,7 +297,7 @@ public:
 		struct state_struct {
 			atomic<unsigned int> active; // just pretend this is a bool
 			unsigned int timer { 0 };
-			weight_slider* slider { nullptr };
+			weight_sensor* sensor { nullptr };
 			state_struct() { active.store(0); }
 			state_struct(state_struct&& state_) { active.store(state_.active); }
 		} state;
@@ -229,8 +307,16 @@ public:
 	};
 	void add_trigger(trigger* trgr);
 	void remove_trigger(trigger* trgr);
+	void move_trigger(trigger* trgr, const uint3& position);
 	const vector<trigger*> get_triggers() const;
+	void set_trigger_identifier(trigger* trgr, const string& identifier);
 	trigger* get_trigger(const string& identifier) const;
+	trigger* get_trigger(const symbol& sym) const;
+	// all triggers at the specified position
+	typedef unordered_multimap<unsigned long long int, trigger*> trigger_position_map;
+	pair<trigger_position_map::const_iterator, trigger_position_map::const_iterator> get_triggers(const uint3& position) const;
+	// the first trigger (in map order) at the specified position or nullptr if there is none
+	trigger* get_first_trigger(const uint3& position) const;
 	
 	// ai functions
 	struct ai_waypoint {
@@ -241,24 +327,57 @@ public:
 	void add_ai_waypoint(ai_waypoint* wp);
 	void remove_ai_waypoint(ai_waypoint* wp);
 	const vector<ai_waypoint*>& get_ai_waypoints() const;
+	void set_ai_waypoint_identifier(ai_waypoint* wp, const string& identifier);
 	ai_waypoint* get_ai_waypoint(const string& identifier) const;
+	ai_waypoint* get_ai_waypoint(const symbol& sym) const;
 	ai_entity* add_ai_entity(const uint3& position);
+	pathfinder* get_pathfinder() const;
 	
 	// render data
 	struct chunk_render_data {
 	public:
 		float3 offset;
 		GLuint ubo;
+		// bounding box of all non-empty blocks of the chunk (min == max if the chunk is empty)
+		float3 content_min;
+		float3 content_max;
+		// compacted block indices of all non-empty blocks, blocks with at least one visible face come first
+		// -> draw visible_instance_count instances with culling, instance_count without culling
+		GLuint instance_ubo;
+		size_t visible_instance_count;
+		size_t instance_count;
+		bool instances_dirty;
+		vector<unsigned int> data; // copy of the block render data in the ubo
 		chunk_render_data(const float3& offset_, array<unsigned int, blocks_per_chunk>& render_data);
 		chunk_render_data(chunk_render_data&& crd);
 		~chunk_render_data();
 	};
 	const vector<chunk_render_data>& get_render_chunks() const;
+	// recompacts the instance lists of all chunks whose block visibility changed (call before drawing)
+	void update_render_instances();
+	
+	// render data of all chunks in single buffers, for drawing the map with one multi-draw-indirect call
+	// (only created if supported, otherwise every chunk must be drawn separately):
+	//  * block data texture: texture buffer with the render data of all blocks (chunk_index * blocks_per_chunk + block index)
+	//  * instance buffer: the instance lists of all chunks, each chunk owns blocks_per_chunk entries starting at
+	//    chunk_index * blocks_per_chunk, each entry is (chunk_index << instance_chunk_shift) | block index
+	static bool is_indirect_rendering_supported();
+	bool has_indirect_render_data() const;
+	GLuint get_block_data_texture() const;
+	GLuint get_instance_buffer() const;
+	static constexpr unsigned int instance_chunk_shift = 12; // log2(blocks_per_chunk)
 	
 	void update_dynamic_render_data();
-	const pair<GLuint, size_t> get_dynamic_render_data() const;
+	// <ubo, instance count> for each batch of dynamic bodies (at most dynamic_batch_size instances per batch)
+	const vector<pair<GLuint, size_t>>& get_dynamic_render_data() const;
+	static constexpr size_t dynamic_batch_size = 1024; // 64kb / 64 bytes
 	
 	static unsigned int remap_material(const BLOCK_MATERIAL& mat);
+	// remapped material + render_flip_flag if the texture is flipped horizontally every other y layer
+	static unsigned int block_render_material(const BLOCK_MATERIAL& mat);
+	static constexpr unsigned int render_flip_flag = 0x8000;
+	
+	chunk_mesher* get_chunk_mesher() const;
 	
 protected:
 	string filename;
@@ -267,18 +386,42 @@ protected:
 	uint3 player_start;
 	float3 player_rotation;
 	vector<chunk> chunks;
+	vector<unsigned int> chunk_block_counts;
 	vector<chunk_render_data> render_chunks;
+	void update_render_bounds(const unsigned int& chunk_index);
+	GLuint indirect_data_buffer = 0;
+	GLuint indirect_data_texture = 0;
+	GLuint indirect_instance_buffer = 0;
+	void create_indirect_render_data();
+	void delete_indirect_render_data();
 	
 	const rigid_info* block_rinfo;
 	vector<unordered_map<unsigned int, rigid_body*>> static_bodies;
 	vector<unordered_map<unsigned int, rigid_body*>> dynamic_body_field;
 	unordered_map<rigid_body*, BLOCK_MATERIAL> dynamic_bodies;
-	array<matrix4f, 1024> dynamic_render_data;
-	size_t dynamic_render_data_size;
-	GLuint dynamic_bodies_ubo = 0;
+	void add_dynamic_body(rigid_body* body, const BLOCK_MATERIAL& mat);
+	void remove_dynamic_body(rigid_body* body);
+	
+	// dynamic render data: each dynamic body owns a matrix slot, slots are split into ubo batches
+	struct dynamic_render_slot {
+		rigid_body* body;
+		const BLOCK_MATERIAL* material; // points into dynamic_bodies
+		BLOCK_MATERIAL rendered_material;
+		float3 rendered_scale;
+	};
+	vector<dynamic_render_slot> dynamic_render_slots;
+	unordered_map<rigid_body*, size_t> dynamic_render_slot_indices;
+	vector<matrix4f> dynamic_render_data;
+	vector<GLuint> dynamic_bodies_ubos;
+	vector<pair<GLuint, size_t>> dynamic_render_batches;
+	size_t dynamic_dirty_min = 0, dynamic_dirty_max = 0; // [min, max)
 
 	vector<unordered_map<unsigned int, light*>> lights;
 	vector<light_color_area*> light_color_areas;
+	vector<vector<light_color_area*>> chunk_light_color_areas; // all areas overlapping a chunk
+	void index_light_color_area(light_color_area* lca);
+	void unindex_light_color_area(light_color_area* lca);
+	pair<uint3, uint3> get_chunk_range(const uint3& min_pos, const uint3& max_pos) const;
 	float3 default_light_color = float3(1.0f);
 	float3 compute_light_color_for_position(const uint3& global_position) const;
 	
@@ -287,30 +430,43 @@ protected:
 	set<audio_3d*> env_sounds;
 	vector<map_link*> map_links;
 	
+	// neighbor flags are updated incrementally when magnet/spring blocks are added or removed
+	vector<array<unsigned char, blocks_per_chunk>> neighbor_flags;
+	void update_neighbor_flags(const int3& position, const int3* offsets, const size_t offset_count,
+							   const BLOCK_MATERIAL& flag_material, const NEIGHBOR_FLAG& flag, const bool added);
+	void rebuild_neighbor_flags();
+	
+	// symbol -> object indices (must be kept in sync by the add/remove/set_*_identifier functions)
+	symbol_index<trigger> trigger_symbols;
+	symbol_index<map_link> map_link_symbols;
+	symbol_index<ai_waypoint> ai_waypoint_symbols;
+	symbol_index<audio_3d> sound_symbols;
+	
+	// position -> object indices (must be kept in sync by the add/remove/move functions)
+	trigger_position_map trigger_positions;
+	unordered_multimap<unsigned long long int, map_link*> map_link_positions;
+	
 	// misc
 	pair<bool, map_link*> map_change { false, nullptr };
 
-	struct spring {
-		const uint3 position;
-		const float3 direction;
-		rigid_info* info;
-		rigid_body* body;
-		float scale; // [0, 1]
-		float state; // pos: extending, neg: retracting
-		unsigned int timer;
-	};
-	vector<spring*> springs;
+	vector<kinematic_spring*> springs;
 	void add_spring(const uint3& position, const float3& direction);
 	
 	struct spawner {
 		const uint3 position;
 		const size_t max_spawns; // min/max?
 		set<ai_entity*> spawns;
+		unsigned char free_neighbors; // bit mask of the empty neighbor blocks (possible spawn positions)
+		unsigned int next_spawn_ticks; // no spawn before this time (cooldown)
 	};
 	vector<spawner*> spawners;
-	vector<ai_entity*> entities;
+	unordered_map<unsigned long long int, spawner*> spawner_positions;
+	ai_store ais;
+	pathfinder* pf = nullptr;
+	chunk_mesher* mesher = nullptr;
 	void add_spawner(const uint3& position);
 	void remove_spawner(const uint3& position);
+	void update_spawner_neighbors(spawner* spwn);
 	
 	// triggers
 	vector<trigger*> triggers;
@@ -0,0 +1,88 @@
+/*
+ *  Blocks In Motion
+ *  Copyright (C) 2012 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "kinematic_spring.h"
+#include "physics_controller.h"
+#include "rigid_body.h"
+
+constexpr float kinematic_spring::step_size;
+constexpr unsigned int kinematic_spring::extension_time;
+
+kinematic_spring::kinematic_spring(const uint3& position_, const float3& direction_, const unsigned int& start_time_) :
+position(position_), direction(direction_), start_time(start_time_)
+{
+	// note: each spring needs its own shape, since it will be scaled
+	info = &pc->add_rigid_info<physics_controller::SHAPE::BOX>(0.0f, float3(0.5f));
+	body = &pc->add_rigid_body(*info, float3(position) + 0.5f);
+	
+	// kinematic bodies are moved through their motion state and will properly push (and wake up) dynamic bodies
+	btRigidBody* bt_body = body->get_body();
+	bt_body->setCollisionFlags(bt_body->getCollisionFlags() | btCollisionObject::CF_KINEMATIC_OBJECT);
+	bt_body->setActivationState(DISABLE_DEACTIVATION);
+	
+	update(start_time);
+}
+
+kinematic_spring::~kinematic_spring() {
+	pc->remove_rigid_body(body);
+	pc->remove_rigid_info(info);
+}
+
+rigid_body* kinematic_spring::get_body() {
+	return body;
+}
+
+const uint3& kinematic_spring::get_position() const {
+	return position;
+}
+
+const float3& kinematic_spring::get_direction() const {
+	return direction;
+}
+
+SPRING_STATE kinematic_spring::get_state() const {
+	return state;
+}
+
+void kinematic_spring::update(const unsigned int& ticks) {
+	if(state == SPRING_STATE::RETRACTED) return;
+	
+	// compute the current extension (solely depends on the start time)
+	const unsigned int elapsed_time = (ticks > start_time ? ticks - start_time : 0);
+	SPRING_STATE new_state;
+	if(elapsed_time < extension_time) {
+		scale = core::clamp(step_size * float(elapsed_time), 0.0f, 1.0f);
+		new_state = (scale < 1.0f ? SPRING_STATE::EXTENDING : SPRING_STATE::EXTENDED);
+	}
+	else {
+		scale = core::clamp(1.0f - step_size * float(elapsed_time - extension_time), 0.0f, 1.0f);
+		new_state = (scale > 0.0f ? SPRING_STATE::RETRACTING : SPRING_STATE::RETRACTED);
+	}
+	
+	const float3 dir_abs(direction.abs());
+	// non-dir scale: 1.0, dir scale: [0, 2]
+	body->set_scale((float3(1.0f) - dir_abs) + dir_abs * scale * 2.0f);
+	// start off by one block into the extension direction (on the spring block side), then accommodate for scale
+	body->set_position(float3(position) + (float3(1.0f) + direction) * 0.5f + direction * scale);
+	
+	if(new_state != state) {
+		state = new_state;
+		eevt->add_event(EVENT_TYPE::SPRING_CHANGE, make_shared<spring_change_event>(SDL_GetTicks(), this, new_state));
+	}
+}
@@ -0,0 +1,66 @@
+/*
+ *  Blocks In Motion
+ *  Copyright (C) 2012 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SB_KINEMATIC_SPRING_H__
+#define __SB_KINEMATIC_SPRING_H__
+
+#include "sb_global.h"
+
+enum class SPRING_STATE : unsigned int {
+	EXTENDING,
+	EXTENDED,
+	RETRACTING,
+	RETRACTED,
+};
+
+// a spring is a kinematic body that is extended into one direction (by up to 2 blocks) and retracted again
+// after a fixed amount of time. the animation is advanced on the physics thread (solely depending on the
+// start time), state transitions are signaled via SPRING_CHANGE events.
+class rigid_body;
+struct rigid_info;
+class kinematic_spring {
+public:
+	kinematic_spring(const uint3& position, const float3& direction, const unsigned int& start_time);
+	~kinematic_spring();
+	
+	rigid_body* get_body();
+	const uint3& get_position() const;
+	const float3& get_direction() const;
+	SPRING_STATE get_state() const;
+	
+	// called by the physics controller before each simulation step
+	void update(const unsigned int& ticks);
+	
+protected:
+	const uint3 position;
+	const float3 direction;
+	const unsigned int start_time;
+	
+	rigid_info* info;
+	rigid_body* body;
+	
+	atomic<SPRING_STATE> state { SPRING_STATE::EXTENDING };
+	float scale = 0.0f; // [0, 1]
+	
+	static constexpr float step_size = 0.0025f; // extension / ms
+	static constexpr unsigned int extension_time = 3000; // ms (including the extension itself)
+	
+};
+
+#endif
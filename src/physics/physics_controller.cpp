@@ -26,9 +26,17 @@
 #include "soft_body.h"
 #include "physics_player.h"
 #include "physics_entity.h"
-#include "weight_slider.h"
+#include "weight_sensor.h"
+#include "kinematic_spring.h"
+#include "game.h"
+#include "ai_store.h"
 
 static constexpr float gravity = -9.81f;
+constexpr short int physics_controller::collision_group_blocks;
+constexpr short int physics_controller::collision_group_characters;
+constexpr float physics_controller::character_mass;
+constexpr size_t physics_controller::think_batch_size;
+constexpr size_t physics_controller::min_parallel_think_entities;
 
 physics_controller::physics_controller() : thread_base("physics"),
 block_handler_fctr(this, &physics_controller::block_handler) {
@@ -52,6 +60,13 @@ block_handler_fctr(this, &physics_controller::block_handler) {
 	do_force_activate.test_and_set();
 	eevt->add_event_handler(block_handler_fctr, EVENT_TYPE::BLOCK_CHANGE);
 	
+	// the physics thread itself also processes think batches -> one worker less
+	static constexpr unsigned int max_think_threads = 4;
+	const unsigned int think_thread_count = std::min(thread::hardware_concurrency(), max_think_threads);
+	for(unsigned int i = 1; i < think_thread_count; i++) {
+		think_workers.emplace_back(&physics_controller::think_worker, this);
+	}
+	
 	this->set_thread_delay(5);
 }
 
@@ -61,9 +76,22 @@ physics_controller::~physics_controller() {
 	// stop physics simulation before we destroy anything
 	this->finish();
 	
-	// remove remaining constraints
-	while(!sliders.empty()) {
-		remove_weight_slider(sliders[0]);
+	{
+		lock_guard<mutex> guard(think_lock);
+		think_shutdown = true;
+	}
+	think_cv.notify_all();
+	for(auto& worker : think_workers) {
+		worker.join();
+	}
+	think_workers.clear();
+	
+	// remove remaining sensors and springs
+	while(!sensors.empty()) {
+		remove_weight_sensor(sensors[0]);
+	}
+	while(!springs.empty()) {
+		remove_kinematic_spring(springs[0]);
 	}
 	
 	// remove the rigid bodies from the dynamics world and delete them
@@ -114,11 +142,6 @@ void physics_controller::resume_simulation() {
 void physics_controller::run() {
 	if(!enabled) return;
 	
-	// check if level has changed -> make all dynamic physics bodies active
-	if(!do_force_activate.test_and_set()) {
-		force_active();
-	}
-	
 	// run the simulation
 	static const float perf_freq(SDL_GetPerformanceFrequency());
 	const size_t cur_time_step = SDL_GetPerformanceCounter();
@@ -126,27 +149,114 @@ void physics_controller::run() {
 	if(sim_step_size == 0) return;
 	prev_time_step = cur_time_step;
 	
+	// check if level has changed -> make all dynamic physics bodies active,
+	// or only wake up the bodies in the neighbourhood of the changed blocks
+	// note: this must happen after the early-out above, so that no block change is lost for this step
+	step_wake_positions.clear();
+	step_wake_positions.swap(wake_positions);
+	if(!do_force_activate.test_and_set()) {
+		force_active();
+	}
+	else {
+		for(const auto& position : step_wake_positions) {
+			wake_bodies(bbox(float3(position) - 1.0f, float3(position) + 2.0f));
+		}
+	}
+	
+	// advance kinematic bodies
+	const unsigned int cur_ticks(SDL_GetTicks());
+	for(const auto& spring : springs) {
+		spring->update(cur_ticks);
+	}
+	
 	dynamics_world->stepSimulation(float(sim_step_size) / perf_freq, 20);
 	total_sim_steps++;
 	
-	//
+	// entity updates: decide in parallel (read-only w.r.t. shared state), then apply serially
+	const float3 player_position(ge != nullptr ? ge->get_position() : float3(0.0f));
+	const physics_snapshot snapshot {
+		player_position,
+		uint3(player_position.floored()),
+		cur_ticks,
+		step_wake_positions
+	};
+	think_list = think_every_step_entities;
+	if(ais != nullptr) ais->schedule(snapshot, think_list);
+	think_entities(snapshot);
 	for(const auto& entity : physics_entities) {
 		entity->physics_update();
 	}
 	
-	// at the beginning of the simulation sliders are highly unstable, so, to make sure
-	// sliders don't get triggered because of this, wait for a couple of simulation steps
-	static const size_t level_off = 32;
-	if(total_sim_steps > level_off) {
-		for(const auto& slider : sliders) {
-			slider->update();
+	// note: sensors will only signal (stable) state transitions
+	for(const auto& sensor : sensors) {
+		sensor->update(dynamics_world);
+	}
+}
+
+void physics_controller::think_entities(const physics_snapshot& snapshot) {
+	if(think_workers.empty() || think_list.size() < min_parallel_think_entities) {
+		for(const auto& entity : think_list) {
+			entity->think(snapshot);
+		}
+		return;
+	}
+	
+	// note: think_list can't be modified in here, since this is called while the physics lock is held
+	{
+		lock_guard<mutex> guard(think_lock);
+		think_snapshot = &snapshot;
+		think_next_index = 0;
+		think_active_workers = think_workers.size();
+		think_generation++;
+	}
+	think_cv.notify_all();
+	think_batches();
+	
+	unique_lock<mutex> guard(think_lock);
+	think_done_cv.wait(guard, [this] { return (think_active_workers == 0); });
+	think_snapshot = nullptr;
+}
+
+void physics_controller::think_batches() {
+	const size_t entity_count = think_list.size();
+	for(;;) {
+		const size_t begin_idx = think_next_index.fetch_add(think_batch_size);
+		if(begin_idx >= entity_count) break;
+		const size_t end_idx = std::min(begin_idx + think_batch_size, entity_count);
+		for(size_t i = begin_idx; i < end_idx; i++) {
+			think_list[i]->think(*think_snapshot);
 		}
 	}
 }
 
-bool physics_controller::block_handler(EVENT_TYPE type, shared_ptr<event_object> obj a2e_unused) {
+void physics_controller::think_worker() {
+	size_t generation = 0;
+	for(;;) {
+		{
+			unique_lock<mutex> guard(think_lock);
+			think_cv.wait(guard, [this, &generation] { return (think_shutdown || think_generation != generation); });
+			if(think_shutdown) return;
+			generation = think_generation;
+		}
+		
+		think_batches();
+		
+		lock_guard<mutex> guard(think_lock);
+		if(--think_active_workers == 0) {
+			think_done_cv.notify_one();
+		}
+	}
+}
+
+bool physics_controller::block_handler(EVENT_TYPE type, shared_ptr<event_object> obj) {
 	if(type != EVENT_TYPE::BLOCK_CHANGE) return false;
-	do_force_activate.clear();
+	const shared_ptr<block_change_event>& change_evt = (shared_ptr<block_change_event>&)obj;
+	lock();
+	if(wake_positions.size() < max_wake_positions) {
+		wake_positions.push_back(change_evt->position);
+	}
+	else do_force_activate.clear();
+	unlock();
 	return true;
 }
 
@@ -262,6 +372,47 @@ void physics_controller::force_active() {
 	}
 }
 
+void physics_controller::wake_bodies(const bbox& box) {
+	struct wake_callback : public btBroadphaseAabbCallback {
+		virtual bool process(const btBroadphaseProxy* proxy) {
+			btCollisionObject* obj = (btCollisionObject*)proxy->m_clientObject;
+			if(!obj->isStaticOrKinematicObject()) obj->activate(true);
+			return true;
+		}
+	} callback;
+	
+	lock();
+	dynamics_world->getBroadphase()->aabbTest(btVector3(box.min.x, box.min.y, box.min.z),
+											  btVector3(box.max.x, box.max.y, box.max.z),
+											  callback);
+	unlock();
+}
+
+physics_controller::ray_hit physics_controller::ray_test(const float3& from, const float3& to, const short int mask, const rigid_body* ignore) {
+	struct closest_body_callback : public btCollisionWorld::ClosestRayResultCallback {
+		const btCollisionObject* ignore_obj;
+		closest_body_callback(const btVector3& from_, const btVector3& to_, const btCollisionObject* ignore_obj_) :
+		btCollisionWorld::ClosestRayResultCallback(from_, to_), ignore_obj(ignore_obj_) {}
+		
+		virtual bool needsCollision(btBroadphaseProxy* proxy) const {
+			if(proxy->m_clientObject == ignore_obj) return false;
+			return btCollisionWorld::ClosestRayResultCallback::needsCollision(proxy);
+		}
+	};
+	
+	const btVector3 bt_from(from.x, from.y, from.z), bt_to(to.x, to.y, to.z);
+	closest_body_callback callback(bt_from, bt_to, (ignore != nullptr ? ((rigid_body*)ignore)->get_body() : nullptr));
+	callback.m_collisionFilterGroup = btBroadphaseProxy::AllFilter;
+	callback.m_collisionFilterMask = mask;
+	
+	lock();
+	dynamics_world->rayTest(bt_from, bt_to, callback);
+	unlock();
+	
+	if(!callback.hasHit()) return ray_hit { nullptr, 1.0f };
+	return ray_hit { (rigid_body*)callback.m_collisionObject->getUserPointer(), callback.m_closestHitFraction };
+}
+
 const vector<rigid_body*>& physics_controller::get_rigid_bodies() const {
 	return rigid_bodies;
 }
@@ -315,6 +466,13 @@ void physics_controller::make_static(rigid_body& body) {
 void physics_controller::add_physics_entity(physics_entity& entity) {
 	lock();
 	physics_entities.push_back(&entity);
+	if(!entity.has_external_think()) {
+		think_every_step_entities.push_back(&entity);
+	}
+	// re-add the character body with its own collision group
+	btRigidBody* body = entity.get_character_body()->get_body();
+	dynamics_world->removeRigidBody(body);
+	dynamics_world->addRigidBody(body, collision_group_characters, btBroadphaseProxy::AllFilter);
 	unlock();
 }
 
@@ -324,6 +482,10 @@ void physics_controller::remove_physics_entity(const physics_entity& entity) {
 	if(iter != end(physics_entities)) {
 		physics_entities.erase(iter);
 	}
+	const auto think_iter = find(begin(think_every_step_entities), end(think_every_step_entities), &entity);
+	if(think_iter != end(think_every_step_entities)) {
+		think_every_step_entities.erase(think_iter);
+	}
 	unlock();
 }
 
@@ -331,22 +493,68 @@ const vector<physics_entity*>& physics_controller::get_physics_entities() const
 	return physics_entities;
 }
 
-weight_slider* physics_controller::add_weight_slider(const float3& position, const float& height, const float& mass) {
+rigid_info& physics_controller::get_character_rigid_info(const float2& character_size) {
+	lock();
+	for(const auto& rinfo : character_rinfos) {
+		if(rinfo.first.x == character_size.x && rinfo.first.y == character_size.y) {
+			unlock();
+			return *rinfo.second;
+		}
+	}
+	rigid_info* rinfo = &add_rigid_info<SHAPE::CAPSULE>(character_mass, character_size.x, character_size.y);
+	rinfo->construction_info->m_friction = 0.001f; // no friction -> no sticking to walls
+	character_rinfos.emplace_back(character_size, rinfo);
+	unlock();
+	return *rinfo;
+}
+
+void physics_controller::set_ai_store(ai_store* store) {
+	lock();
+	ais = store;
+	unlock();
+}
+
+weight_sensor* physics_controller::add_weight_sensor(const float3& position, const float& mass) {
+	lock();
+	weight_sensor* sensor = new weight_sensor(position, mass);
+	// the ghost object only needs to collide with dynamic objects
+	dynamics_world->addCollisionObject(sensor->get_ghost_object(), btBroadphaseProxy::SensorTrigger,
+									   btBroadphaseProxy::AllFilter & ~(btBroadphaseProxy::SensorTrigger | btBroadphaseProxy::StaticFilter));
+	sensors.push_back(sensor);
+	unlock();
+	return sensor;
+}
+
+void physics_controller::remove_weight_sensor(weight_sensor* sensor) {
+	lock();
+	const auto iter = find(begin(sensors), end(sensors), sensor);
+	if(iter != end(sensors)) {
+		sensors.erase(iter);
+		dynamics_world->removeCollisionObject(sensor->get_ghost_object());
+		delete sensor;
+	}
+	unlock();
+}
+
+kinematic_spring* physics_controller::add_kinematic_spring(const uint3& position, const float3& direction) {
 	lock();
-	weight_slider* slider = new weight_slider(position, height, mass);
-	dynamics_world->addConstraint(slider->get_constraint(), true);
-	sliders.push_back(slider);
+	kinematic_spring* spring = new kinematic_spring(position, direction, SDL_GetTicks());
+	// re-add the spring body as a kinematic body (it was added as a static one)
+	btRigidBody* body = spring->get_body()->get_body();
+	dynamics_world->removeRigidBody(body);
+	dynamics_world->addRigidBody(body, btBroadphaseProxy::KinematicFilter,
+								 btBroadphaseProxy::AllFilter ^ (btBroadphaseProxy::StaticFilter | btBroadphaseProxy::KinematicFilter));
+	springs.push_back(spring);
 	unlock();
-	return slider;
+	return spring;
 }
 
-void physics_controller::remove_weight_slider(weight_slider* slider) {
+void physics_controller::remove_kinematic_spring(kinematic_spring* spring) {
 	lock();
-	const auto iter = find(begin(sliders), end(sliders), slider);
-	if(iter != end(sliders)) {
-		sliders.erase(iter);
-		dynamics_world->removeConstraint(slider->get_constraint());
-		delete slider;
+	const auto iter = find(begin(springs), end(springs), spring);
+	if(iter != end(springs)) {
+		springs.erase(iter);
+		delete spring;
 	}
 	unlock();
 }
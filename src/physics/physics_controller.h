@@ -24,7 +24,9 @@
 #include "sb_global.h"
 #include <threading/thread_base.h>
 #include <scene/model/a2emodel.h>
+#include <core/bbox.h>
 #include <atomic>
+#include <condition_variable>
 
 class btSoftBodyRigidBodyCollisionConfiguration;
 class btSoftRigidDynamicsWorld;
@@ -36,7 +38,10 @@ struct soft_info;
 class soft_body;
 class physics_player;
 class physics_entity;
-class weight_slider;
+struct physics_snapshot;
+class ai_store;
+class weight_sensor;
+class kinematic_spring;
 class physics_controller : public thread_base {
 public:
 	physics_controller();
@@ -79,13 +84,23 @@ public:
 	const vector<soft_body*>& get_soft_bodies() const;
 	
 	//
-	weight_slider* add_weight_slider(const float3& position, const float& height, const float& mass);
-	void remove_weight_slider(weight_slider* slider);
+	weight_sensor* add_weight_sensor(const float3& position, const float& mass);
+	void remove_weight_sensor(weight_sensor* sensor);
+	
+	// note: the spring animation is advanced on the physics thread
+	kinematic_spring* add_kinematic_spring(const uint3& position, const float3& direction);
+	void remove_kinematic_spring(kinematic_spring* spring);
 	
 	//
 	void add_physics_entity(physics_entity& entity);
 	void remove_physics_entity(const physics_entity& entity);
 	const vector<physics_entity*>& get_physics_entities() const;
+	
+	// character capsules (physics entities) of the same size share their rigid info (mass 10, no friction)
+	rigid_info& get_character_rigid_info(const float2& character_size);
+	
+	// the ai store schedules the think phase of all ais (nullptr if there is none)
+	void set_ai_store(ai_store* store);
 
 	static float get_global_gravity();
 	static btVector3 get_global_bullet_gravity();
@@ -93,6 +108,25 @@ public:
 	void disable_body(rigid_body* body);
 	void enable_body(rigid_body* body);
 	
+	// wakes up all (non-static) bodies whose aabb overlaps the specified bbox
+	void wake_bodies(const bbox& box);
+	
+	// collision groups (also used as ray query masks):
+	// dynamic bodies and kinematic springs are "blocks", physics entities (player and ai) are "characters"
+	static constexpr short int collision_group_blocks = (btBroadphaseProxy::DefaultFilter | btBroadphaseProxy::KinematicFilter);
+	static constexpr short int collision_group_characters = btBroadphaseProxy::CharacterFilter;
+	
+	// mass of a character body (player and ai), also the reference mass for weight triggers
+	static constexpr float character_mass = 10.0f;
+	
+	// casts a ray from "from" to "to" against all bodies matching the collision mask (this uses the broadphase),
+	// "ignore" can be used to exclude a specific body (e.g. the player body when casting from the camera)
+	struct ray_hit {
+		rigid_body* body;
+		float fraction; // [0, 1] along the ray
+	};
+	ray_hit ray_test(const float3& from, const float3& to, const short int mask, const rigid_body* ignore = nullptr);
+	
 protected:
 	// global/world data
 	btSoftBodyRigidBodyCollisionConfiguration* collision_configuration = nullptr;
@@ -113,6 +147,28 @@ protected:
 	};
 	
 	vector<physics_entity*> physics_entities;
+	// entities that think every step (i.e. w/o external scheduling) and the entities thinking in the current step
+	vector<physics_entity*> think_every_step_entities;
+	vector<physics_entity*> think_list;
+	ai_store* ais = nullptr;
+	vector<pair<float2, rigid_info*>> character_rinfos;
+	
+	// entity think phase: the entities are processed in batches by the physics thread and a pool of
+	// worker threads (only if there are enough entities, otherwise everything is done serially)
+	static constexpr size_t think_batch_size = 8;
+	static constexpr size_t min_parallel_think_entities = 32;
+	vector<thread> think_workers;
+	mutex think_lock;
+	condition_variable think_cv;
+	condition_variable think_done_cv;
+	const physics_snapshot* think_snapshot = nullptr;
+	atomic<size_t> think_next_index { 0 };
+	size_t think_generation = 0;
+	size_t think_active_workers = 0;
+	bool think_shutdown = false;
+	void think_entities(const physics_snapshot& snapshot);
+	void think_batches();
+	void think_worker();
 	
 	// soft body data
 	vector<soft_body*> soft_bodies;
@@ -121,6 +177,13 @@ protected:
 	event::handler block_handler_fctr;
 	bool block_handler(EVENT_TYPE type, shared_ptr<event_object> obj);
 	
+	// positions of changed blocks, whose neighbourhood will be woken up in the next simulation step
+	static constexpr size_t max_wake_positions = 256;
+	vector<uint3> wake_positions;
+	// wake positions of the current simulation step (also handed to the entities)
+	vector<uint3> step_wake_positions;
+	
+	// if too many blocks have changed at once (e.g. on map load), simply wake up all bodies
 	atomic_flag do_force_activate = ATOMIC_FLAG_INIT; // true = no, false = yes
 	void force_active();
 	
@@ -129,8 +192,11 @@ protected:
 	bool enabled = false;
 	size_t total_sim_steps = 0;
 	
-	// constraints
-	vector<weight_slider*> sliders;
+	// sensors
+	vector<weight_sensor*> sensors;
+	
+	// kinematic bodies
+	vector<kinematic_spring*> springs;
 
 };
 
@@ -20,30 +20,24 @@
 #include "physics_entity.h"
 #include "physics_controller.h"
 #include "sb_map.h"
+#include "map_renderer.h"
 #include <engine.h>
 #include <scene/scene.h>
 #include <scene/camera.h>
 
 static constexpr float step_length = 1.5f;
 
-physics_entity::physics_entity(const float3& position, const float2 character_size_, const string model_filename, const string material_filename) :
-character_size(character_size_) {
+physics_entity::physics_entity(const float3& position, const float2 character_size_, const string model_filename, const string material_filename, const bool external_think_) :
+character_size(character_size_), external_think(external_think_) {
 	//
-	mat = new a2ematerial(e);
-	mat->load_material(e->data_path(material_filename.empty() ? "sphere.a2mtl" : material_filename));
-	
-	mdl = sce->create_a2emodel<a2estatic>();
-	mdl->load_model(e->data_path(model_filename.empty() ? "cylinder.a2m" : model_filename));
-	mdl->set_material(mat);
-	mdl->set_position(position);
-	mdl->set_hard_scale(character_size.x, character_size.y, character_size.x);
-	sce->add_model(mdl);
+	model = mr->get_entity_model(model_filename.empty() ? "cylinder.a2m" : model_filename,
+								 material_filename.empty() ? "sphere.a2mtl" : material_filename,
+								 float3(character_size.x, character_size.y, character_size.x));
 	
 	//
 	pc->lock();
-	character_rinfo = &pc->add_rigid_info<physics_controller::SHAPE::CAPSULE>(10.0f, character_size.x, character_size.y);
-	character_rinfo->construction_info->m_friction = 0.001f; // no friction -> no sticking to walls
-	character_body = &pc->add_rigid_body(*character_rinfo, position, mdl);
+	character_rinfo = &pc->get_character_rigid_info(character_size);
+	character_body = &pc->add_rigid_body(*character_rinfo, position);
 	body = character_body->get_body();
 	body->setSleepingThresholds(0.0f, 0.0f);
 	body->setAngularFactor(0.0f);
@@ -53,15 +47,13 @@ character_size(character_size_) {
 
 physics_entity::~physics_entity() {
 	pc->remove_physics_entity(*this);
-	if(mdl != nullptr) {
-		sce->delete_model(mdl);
-		delete mdl;
-	}
-	if(mat != nullptr) delete mat;
 	
 	pc->remove_rigid_body(character_body);
 }
 
+void physics_entity::think(const physics_snapshot& snapshot a2e_unused) {
+}
+
 void physics_entity::physics_update() {
 	const btVector3 cur_lvel(body->getLinearVelocity() * btVector3(prev_velocity_scale, 1.0f, prev_velocity_scale));
 	float3 velocity = move_direction * speed;
@@ -87,9 +79,18 @@ void physics_entity::physics_update() {
 	cur_velocity = velocity;
 }
 
+bool physics_entity::has_external_think() const {
+	return external_think;
+}
+
+uint3 physics_entity::get_block_position() const {
+	const float3 pos(get_position());
+	return uint3(float3(pos.x, pos.y - character_size.y * 0.5f, pos.z).floored());
+}
+
 void physics_entity::graphics_update() {
-	const float3 pos(mdl->get_position());
-	const uint3 cur_block(float3(pos.x, pos.y - character_size.y * 0.5f, pos.z).floored());
+	const float3 pos(get_position());
+	const uint3 cur_block(get_block_position());
 	if((cur_block != prev_block).any()) {
 		prev_block = cur_block;
 		// try not to add events for invalid block positions
@@ -130,8 +131,24 @@ const float3& physics_entity::get_position() const {
 	return character_body->get_position();
 }
 
-void physics_entity::set_rotation(const float3& rotation) {
-	mdl->set_rotation(rotation);
+void physics_entity::set_rotation(const float3& rotation_) {
+	rotation = rotation_;
+}
+
+const float3& physics_entity::get_rotation() const {
+	return rotation;
+}
+
+entity_model* physics_entity::get_model() const {
+	return model;
+}
+
+void physics_entity::set_visible(const bool& state) {
+	visible = state;
+}
+
+bool physics_entity::is_visible() const {
+	return visible;
 }
 
 void physics_entity::set_move_direction(const float3& direction) {
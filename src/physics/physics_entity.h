@@ -23,22 +23,45 @@
 #include "sb_global.h"
 #include "rigid_body.h"
 
-class a2estatic;
-class a2ematerial;
+struct entity_model;
+
+// consistent view of the shared game state for one physics step (taken before the think phase)
+struct physics_snapshot {
+	float3 player_position;
+	uint3 player_block;
+	unsigned int ticks;
+	const vector<uint3>& changed_blocks; // blocks changed since the previous step (limited, see physics_controller)
+};
+
 class physics_entity {
 public:
-	physics_entity(const float3& position, const float2 character_size = float2(0.5f, 1.25f), const string model_filename = "", const string material_filename = "");
+	// note: if external_think is true, think is not called by the physics controller for every step,
+	// but only when the entity is scheduled by an external store (e.g. ai_store)
+	physics_entity(const float3& position, const float2 character_size = float2(0.5f, 1.25f), const string model_filename = "", const string material_filename = "", const bool external_think = false);
 	virtual ~physics_entity();
 	
-	// note: physics_update is called from the physics controller thread
+	// note: think is called from the physics controller thread or one of its worker threads,
+	// in parallel for all entities -> it may only modify the entity itself (no bullet body or
+	// other shared state) and must use the snapshot for the player state
+	virtual void think(const physics_snapshot& snapshot);
+	// note: physics_update is called serially from the physics controller thread once the think
+	// phase has finished for all entities and applies its results (velocities etc.)
 	virtual void physics_update();
 	// note: graphics_update is called from the main render thread/loop
 	virtual void graphics_update();
 	
 	virtual void set_position(const float3& position);
 	virtual const float3& get_position() const;
+	// the block the lower part of the entity is in
+	uint3 get_block_position() const;
 	
 	virtual void set_rotation(const float3& rotation);
+	const float3& get_rotation() const;
+	
+	// note: the model is shared by all entities using the same model/material (see map_renderer::get_entity_model)
+	entity_model* get_model() const;
+	void set_visible(const bool& state);
+	bool is_visible() const;
 	
 	virtual void set_move_direction(const float3& direction);
 	virtual const float3& get_move_direction() const;
@@ -53,14 +76,17 @@ public:
 
 	rigid_info* get_character_info();
 	rigid_body* get_character_body();
+	
+	bool has_external_think() const;
 
 protected:
 	rigid_info* character_rinfo = nullptr;
 	rigid_body* character_body = nullptr;
 	btRigidBody* body = nullptr;
 	
-	a2estatic* mdl = nullptr;
-	a2ematerial* mat = nullptr;
+	entity_model* model = nullptr;
+	float3 rotation;
+	bool visible = true;
 	
 	float3 move_direction;
 	
@@ -68,6 +94,7 @@ protected:
 	
 	//
 	const float2 character_size; // (radius, half-height)
+	const bool external_think;
 	float step_height = 1.0f; // one block
 	float speed = 5.0f;
 	float default_speed = speed;
@@ -46,7 +46,7 @@ evt_handler(this, &physics_player::event_handler) {
 
 	timer_mseconds = SDL_GetTicks();
 	
-	mdl->set_visible(false);
+	set_visible(false);
 }
 
 physics_player::~physics_player() {
@@ -125,7 +125,7 @@ void physics_player::graphics_update() {
 	// update cam
 	if(!camera_control) return;
 	physics_entity::graphics_update();
-	const float3 pos(mdl->get_position());
+	const float3 pos(get_position());
 	cam->set_position(-pos.x, -(pos.y + character_size.y), -pos.z);
 }
 
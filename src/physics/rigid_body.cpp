@@ -41,6 +41,8 @@ position(position_)
 	transform.setOrigin(btVector3(position.x, position.y, position.z));
 	motion_state = new btDefaultMotionState(transform);
 	body->setMotionState(motion_state);
+	// used to map bullet bodies back to their rigid_body (e.g. for ray queries)
+	body->setUserPointer(this);
 }
 
 rigid_body::~rigid_body() {
@@ -86,6 +88,8 @@ void rigid_body::set_position(const float3& position_) {
 	pc->lock();
 	position = position_;
 	body->getWorldTransform().setOrigin(btVector3(position.x, position.y, position.z));
+	// kinematic bodies are moved through their motion state
+	if(body->isKinematicObject()) motion_state->setWorldTransform(body->getWorldTransform());
 	pc->unlock();
 	if(linked_mdl != nullptr) linked_mdl->set_position(position);
 }
@@ -0,0 +1,120 @@
+/*
+ *  Blocks In Motion
+ *  Copyright (C) 2012 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "weight_sensor.h"
+#include "physics_controller.h"
+#include "rigid_body.h"
+#include <BulletCollision/CollisionDispatch/btGhostObject.h>
+
+constexpr size_t weight_sensor::transition_steps;
+
+weight_sensor::weight_sensor(const float3& position_, const float& mass_) :
+position(position_), mass(mass_)
+{
+	// create the (static) plate body
+	constexpr float plate_height = 0.025f;
+	plate_info = &pc->add_rigid_info<physics_controller::SHAPE::BOX>(0.0f, float3(0.5f, plate_height, 0.5f));
+	plate_body = &pc->add_rigid_body(*plate_info, position + float3(0.5f, plate_height, 0.5f));
+	
+	// create the ghost object directly above the plate (slightly smaller, so that neighbouring blocks aren't detected)
+	constexpr float ghost_height = 0.1f;
+	ghost_shape = new btBoxShape(btVector3(0.45f, ghost_height, 0.45f));
+	ghost = new btPairCachingGhostObject();
+	ghost->setCollisionShape(ghost_shape);
+	ghost->setCollisionFlags(ghost->getCollisionFlags() | btCollisionObject::CF_NO_CONTACT_RESPONSE);
+	// the ghost object has no solver cost, but must never be deactivated, since it wouldn't detect any contacts otherwise
+	ghost->setActivationState(DISABLE_DEACTIVATION);
+	btTransform ghost_transform(btTransform::getIdentity());
+	ghost_transform.setOrigin(btVector3(position.x + 0.5f,
+										position.y + plate_height * 2.0f + ghost_height,
+										position.z + 0.5f));
+	ghost->setWorldTransform(ghost_transform);
+}
+
+weight_sensor::~weight_sensor() {
+	pc->remove_rigid_body(plate_body);
+	pc->remove_rigid_info(plate_info);
+	delete ghost;
+	delete ghost_shape;
+}
+
+rigid_body* weight_sensor::get_plate_body() {
+	return plate_body;
+}
+
+btPairCachingGhostObject* weight_sensor::get_ghost_object() {
+	return ghost;
+}
+
+bool weight_sensor::is_triggered() const {
+	return triggered;
+}
+
+float weight_sensor::get_resting_mass() const {
+	return resting_mass;
+}
+
+void weight_sensor::update(btCollisionWorld* world) {
+	// nothing on the plate and nothing to signal -> early out
+	const int overlap_count = ghost->getNumOverlappingObjects();
+	if(overlap_count == 0 && !triggered && transition_counter == 0) {
+		resting_mass = 0.0f;
+		return;
+	}
+	
+	// sum up the mass of all dynamic bodies that are actually in contact with the ghost object
+	// note: the ghost pair cache is never dispatched (-> has no collision algorithms), so the contact
+	// manifolds must be taken from the corresponding pair in the world pair cache
+	resting_mass = 0.0f;
+	btOverlappingPairCache* world_pairs = world->getPairCache();
+	btBroadphasePairArray& pairs(ghost->getOverlappingPairCache()->getOverlappingPairArray());
+	btManifoldArray manifolds;
+	for(int i = 0; i < pairs.size(); i++) {
+		const btBroadphasePair* world_pair = world_pairs->findPair(pairs[i].m_pProxy0, pairs[i].m_pProxy1);
+		if(world_pair == nullptr || world_pair->m_algorithm == nullptr) continue;
+		const btCollisionObject* obj0 = (const btCollisionObject*)pairs[i].m_pProxy0->m_clientObject;
+		const btCollisionObject* obj1 = (const btCollisionObject*)pairs[i].m_pProxy1->m_clientObject;
+		const btRigidBody* body = btRigidBody::upcast(obj0 == ghost ? obj1 : obj0);
+		if(body == nullptr || body->getInvMass() == 0.0f) continue;
+		
+		manifolds.resize(0);
+		world_pair->m_algorithm->getAllContactManifolds(manifolds);
+		bool in_contact = false;
+		for(int j = 0; j < manifolds.size() && !in_contact; j++) {
+			for(int p = 0; p < manifolds[j]->getNumContacts(); p++) {
+				if(manifolds[j]->getContactPoint(p).getDistance() < 0.0f) {
+					in_contact = true;
+					break;
+				}
+			}
+		}
+		if(in_contact) resting_mass += 1.0f / body->getInvMass();
+	}
+	
+	// only signal stable transitions
+	const bool new_state(resting_mass >= mass);
+	if(new_state == triggered) {
+		transition_counter = 0;
+		return;
+	}
+	if(++transition_counter < transition_steps) return;
+	transition_counter = 0;
+	triggered = new_state;
+	eevt->add_event(EVENT_TYPE::WEIGHT_SENSOR_CHANGE, make_shared<weight_sensor_change_event>(SDL_GetTicks(), this, triggered));
+}
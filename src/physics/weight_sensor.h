@@ -0,0 +1,66 @@
+/*
+ *  Blocks In Motion
+ *  Copyright (C) 2012 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SB_WEIGHT_SENSOR_H__
+#define __SB_WEIGHT_SENSOR_H__
+
+#include "sb_global.h"
+#include <BulletDynamics/btBulletDynamicsCommon.h>
+
+// a weight sensor consists of a static plate and a ghost object directly above it, which is used to
+// find all bodies resting on the plate: if their accumulated mass reaches the sensor mass, the sensor
+// is triggered (transitions are signaled via WEIGHT_SENSOR_CHANGE events, there is no need to poll it).
+// note: the sensor mass is the required load (in the same unit as rigid body masses, a character weighs
+// 10), not the mass of the old weight slider tray (see map_storage for the conversion of old maps)
+class rigid_body;
+struct rigid_info;
+class btPairCachingGhostObject;
+class btCollisionWorld;
+class weight_sensor {
+public:
+	weight_sensor(const float3& position, const float& mass);
+	~weight_sensor();
+	
+	rigid_body* get_plate_body();
+	btPairCachingGhostObject* get_ghost_object();
+	
+	bool is_triggered() const;
+	float get_resting_mass() const;
+	
+	// called by the physics controller after each simulation step
+	void update(btCollisionWorld* world);
+	
+protected:
+	const float3 position;
+	const float mass;
+	
+	rigid_body* plate_body;
+	rigid_info* plate_info;
+	btPairCachingGhostObject* ghost;
+	btBoxShape* ghost_shape;
+	
+	float resting_mass = 0.0f;
+	atomic<bool> triggered { false };
+	// a state change must be stable for this amount of simulation steps, before it is signaled
+	static constexpr size_t transition_steps = 8;
+	size_t transition_counter = 0;
+	
+};
+
+#endif
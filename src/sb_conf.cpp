@@ -111,6 +111,7 @@ void conf::init() {
 	// ultra, high (default), mid, low
 	conf::add<string>("gfx.texture_quality", config_doc.get<string>("config.bim.gfx.texture.quality", "high"));
 	conf::add<bool>("gfx.particles", config_doc.get<bool>("config.bim.gfx.particles.enabled", true));
+	conf::add<bool>("gfx.chunk_meshes", config_doc.get<bool>("config.bim.gfx.chunk_meshes.enabled", true));
 	
 	// audio settings:
 	conf::add<float>("volume.music", config_doc.get<float>("config.bim.volume.music", 1.0f), [](const float& val a2e_unused) {
@@ -30,7 +30,10 @@
 	PLAYER_BLOCK_STEP,		/* triggered after the player moved onto a new block (continuity not guaranteed!) */ \
 	AI_STEP,				/* triggered after the ai moved by "one step unit" */ \
 	AI_BLOCK_STEP,			/* triggered after the ai moved onto a new block (continuity not guaranteed!) */ \
-	AUDIO_STORE_LOAD,		/* triggered after the audio store loaded a file successfully */
+	AI_DESTROY,				/* triggered right before an ai entity is deleted (the ai must not be accessed any more) */ \
+	AUDIO_STORE_LOAD,		/* triggered after the audio store loaded a file successfully */ \
+	WEIGHT_SENSOR_CHANGE,	/* triggered by the physics controller when a weight sensor gets triggered or untriggered */ \
+	SPRING_CHANGE,			/* triggered by the physics controller when a spring is fully extended, starts retracting or is fully retracted */
 
 #include <gui/event.h>
 
@@ -38,8 +41,9 @@
 template<EVENT_TYPE event_type> struct block_event_base : public event_object_base<event_type> {
 	const unsigned int chunk_idx;
 	const unsigned int block_idx;
-	block_event_base(const unsigned int& time_, const unsigned int& chunk_idx_, const unsigned int& block_idx_)
-	: event_object_base<event_type>(time_), chunk_idx(chunk_idx_), block_idx(block_idx_) {}
+	const uint3 position; // global block position
+	block_event_base(const unsigned int& time_, const unsigned int& chunk_idx_, const unsigned int& block_idx_, const uint3& position_)
+	: event_object_base<event_type>(time_), chunk_idx(chunk_idx_), block_idx(block_idx_), position(position_) {}
 };
 
 enum class BLOCK_MATERIAL : unsigned int;
@@ -47,8 +51,8 @@ template<EVENT_TYPE event_type> struct block_change_event_base : public block_ev
 	const BLOCK_MATERIAL old_material;
 	const BLOCK_MATERIAL new_material;
 	block_change_event_base(const unsigned int& time_, const unsigned int& chunk_idx_, const unsigned int& block_idx_,
-							const BLOCK_MATERIAL& old_material_, const BLOCK_MATERIAL& new_material_)
-	: block_event_base<event_type>(time_, chunk_idx_, block_idx_),
+							const uint3& position_, const BLOCK_MATERIAL& old_material_, const BLOCK_MATERIAL& new_material_)
+	: block_event_base<event_type>(time_, chunk_idx_, block_idx_, position_),
 	old_material(old_material_), new_material(new_material_) {}
 };
 typedef block_change_event_base<EVENT_TYPE::BLOCK_CHANGE> block_change_event;
@@ -86,6 +90,28 @@ struct ai_block_step_event : public event_object_base<EVENT_TYPE::AI_BLOCK_STEP>
 	ai_block_step_event(const unsigned int& time_, const uint3& block_, const ai_entity* ai_)
 	: event_object_base<EVENT_TYPE::AI_BLOCK_STEP>(time_), block(block_), ai(ai_) {}
 };
+struct ai_destroy_event : public event_object_base<EVENT_TYPE::AI_DESTROY> {
+	const ai_entity* ai; // note: only usable as an identifier
+	ai_destroy_event(const unsigned int& time_, const ai_entity* ai_)
+	: event_object_base<EVENT_TYPE::AI_DESTROY>(time_), ai(ai_) {}
+};
+
+// physics events
+class weight_sensor;
+struct weight_sensor_change_event : public event_object_base<EVENT_TYPE::WEIGHT_SENSOR_CHANGE> {
+	const weight_sensor* sensor;
+	const bool triggered;
+	weight_sensor_change_event(const unsigned int& time_, const weight_sensor* sensor_, const bool& triggered_)
+	: event_object_base<EVENT_TYPE::WEIGHT_SENSOR_CHANGE>(time_), sensor(sensor_), triggered(triggered_) {}
+};
+class kinematic_spring;
+enum class SPRING_STATE : unsigned int;
+struct spring_change_event : public event_object_base<EVENT_TYPE::SPRING_CHANGE> {
+	const kinematic_spring* spring;
+	const SPRING_STATE state;
+	spring_change_event(const unsigned int& time_, const kinematic_spring* spring_, const SPRING_STATE& state_)
+	: event_object_base<EVENT_TYPE::SPRING_CHANGE>(time_), spring(spring_), state(state_) {}
+};
 
 // audio store events
 struct audio_store_load_event : public event_object_base<EVENT_TYPE::AUDIO_STORE_LOAD> {
@@ -41,6 +41,25 @@ const string& script::get_filename() const {
 	return filename;
 }
 
+static const unordered_map<string, script::COMMAND> script_commands {
+	{ "nop", script::COMMAND::NOP },
+	{ "add", script::COMMAND::ADD_BLOCK },
+	{ "delete", script::COMMAND::DELETE_BLOCK },
+	{ "modify", script::COMMAND::MODIFY_BLOCK },
+	{ "toggle", script::COMMAND::TOGGLE_BLOCK },
+	{ "make_dynamic", script::COMMAND::MAKE_DYNAMIC },
+	{ "call", script::COMMAND::CALL },
+	{ "call_script", script::COMMAND::CALL_SCRIPT },
+	{ "activate", script::COMMAND::ACTIVATE },
+	{ "deactivate", script::COMMAND::DEACTIVATE },
+	{ "trigger", script::COMMAND::TRIGGER },
+	{ "play_sound", script::COMMAND::PLAY_SOUND },
+	{ "kill_lights", script::COMMAND::KILL_LIGHTS },
+	{ "light_color", script::COMMAND::LIGHT_COLOR },
+	{ "delete_trigger", script::COMMAND::DELETE_TRIGGER },
+	{ "move_trigger", script::COMMAND::MOVE_TRIGGER },
+};
+
 void script::load(const string& filename_) {
 	stringstream buffer(ios::in | ios::out);
 	if(!file_io::file_to_buffer(filename_, buffer)) {
@@ -49,6 +68,15 @@ void script::load(const string& filename_) {
 	}
 	
 	string line_str = "", token = "", cur_identifier = "";
+	const auto token_to_cmd = [&cur_identifier,&filename_](const string& cmd_token) -> COMMAND {
+		const auto cmd = script_commands.find(cmd_token);
+		if(cmd == script_commands.end()) {
+			a2e_error("invalid command \"%s\" in function \"%s\" in script \"%s\"!", cmd_token, cur_identifier, filename_);
+			return COMMAND::NOP;
+		}
+		return cmd->second;
+	};
+	
 	script_function* cur_script = nullptr;
 	bool in_block = false;
 	while(getline(buffer, line_str)) {
@@ -83,6 +111,24 @@ void script::load(const string& filename_) {
 															   line_str.substr(line.tellg(), line_str.size() - line.tellg()) :
 															   ""),
 															  ' '));
+				
+				// resolve the command and intern the identifier of the referenced map object (if any)
+				const vector<string>& tokens(cur_script->lines.back());
+				const COMMAND cmd(token_to_cmd(tokens[0]));
+				symbol sym = symbol_table::invalid_symbol;
+				switch(cmd) {
+					case COMMAND::ACTIVATE:
+					case COMMAND::DEACTIVATE:
+						if(tokens.size() > 2) sym = symbol_table::intern(tokens[2]);
+						break;
+					case COMMAND::DELETE_TRIGGER:
+					case COMMAND::MOVE_TRIGGER:
+						if(tokens.size() > 1) sym = symbol_table::intern(tokens[1]);
+						break;
+					default: break;
+				}
+				cur_script->commands.emplace_back(cmd);
+				cur_script->symbols.emplace_back(sym);
 				break;
 			}
 		}
@@ -101,24 +147,6 @@ void script::execute(sb_map* cur_map, const string& identifier, const uint3 posi
 	}
 	
 	// helper functions (string <-> type conversion)
-	static const unordered_map<string, COMMAND> commands {
-		{ "nop", COMMAND::NOP },
-		{ "add", COMMAND::ADD_BLOCK },
-		{ "delete", COMMAND::DELETE_BLOCK },
-		{ "modify", COMMAND::MODIFY_BLOCK },
-		{ "toggle", COMMAND::TOGGLE_BLOCK },
-		{ "make_dynamic", COMMAND::MAKE_DYNAMIC },
-		{ "call", COMMAND::CALL },
-		{ "call_script", COMMAND::CALL_SCRIPT },
-		{ "activate", COMMAND::ACTIVATE },
-		{ "deactivate", COMMAND::DEACTIVATE },
-		{ "trigger", COMMAND::TRIGGER },
-		{ "play_sound", COMMAND::PLAY_SOUND },
-		{ "kill_lights", COMMAND::KILL_LIGHTS },
-		{ "light_color", COMMAND::LIGHT_COLOR },
-		{ "delete_trigger", COMMAND::DELETE_TRIGGER },
-		{ "move_trigger", COMMAND::MOVE_TRIGGER },
-	};
 	const auto valid_cmd_token_count = [](const COMMAND& cmd, const vector<string>& tokens) -> bool {
 		static const unordered_map<unsigned int, size_t> command_token_count {
 			{ (unsigned int)COMMAND::ADD_BLOCK, 5 },
@@ -140,13 +168,6 @@ void script::execute(sb_map* cur_map, const string& identifier, const uint3 posi
 		return (command_token_count.count((unsigned int)cmd) == 0 ?
 				false : command_token_count.at((unsigned int)cmd) == tokens.size());
 	};
-	const auto token_to_cmd = [&identifier,this](const string token) -> COMMAND {
-		if(commands.count(token) == 0) {
-			a2e_error("invalid command \"%s\" in function \"%s\" in script \"%s\"!", token, identifier, filename);
-			return COMMAND::NOP;
-		}
-		return commands.at(token);
-	};
 	const auto token_to_mat = [&identifier,this](const string& token) -> BLOCK_MATERIAL {
 		static const unordered_map<string, BLOCK_MATERIAL> materials {
 			{ "NONE", BLOCK_MATERIAL::NONE },
@@ -183,8 +204,10 @@ void script::execute(sb_map* cur_map, const string& identifier, const uint3 posi
 				  cur_cmd_str, identifier, filename, msg);
 	};
 	const script_function& func(functions.at(identifier));
-	for(const auto& cmd : func.lines) {
-		cur_cmd = token_to_cmd(cmd[0]);
+	for(size_t line_idx = 0, line_count = func.lines.size(); line_idx < line_count; line_idx++) {
+		const vector<string>& cmd(func.lines[line_idx]);
+		const symbol& sym(func.symbols[line_idx]);
+		cur_cmd = func.commands[line_idx];
 		cur_cmd_str = cmd[0];
 		if(cur_cmd != COMMAND::NOP &&
 		   !valid_cmd_token_count(cur_cmd, cmd)) {
@@ -279,7 +302,7 @@ void script::execute(sb_map* cur_map, const string& identifier, const uint3 posi
 			case COMMAND::ACTIVATE: {
 				const bool state(cur_cmd == COMMAND::ACTIVATE);
 				if(cmd[1] == "door") {
-					sb_map::map_link* ml = cur_map->get_map_link(cmd[2]);
+					sb_map::map_link* ml = cur_map->get_map_link(sym);
 					if(ml == nullptr) {
 						script_error("there is no map link with the name \""+cmd[2]+"\"");
 						break;
@@ -287,7 +310,7 @@ void script::execute(sb_map* cur_map, const string& identifier, const uint3 posi
 					ml->enabled = state;
 				}
 				else if(cmd[1] == "trigger") {
-					sb_map::trigger* trgr = cur_map->get_trigger(cmd[2]);
+					sb_map::trigger* trgr = cur_map->get_trigger(sym);
 					if(trgr == nullptr) {
 						script_error("there is no trigger with the name \""+cmd[2]+"\"");
 						break;
@@ -296,7 +319,7 @@ void script::execute(sb_map* cur_map, const string& identifier, const uint3 posi
 					else trgr->deactivate(cur_map);
 				}
 				else if(cmd[2] == "sound") {
-					audio_3d* snd = cur_map->get_sound(cmd[2]);
+					audio_3d* snd = cur_map->get_sound(sym);
 					if(snd == nullptr) {
 						script_error("there is no sound with the name \""+cmd[2]+"\"");
 						break;
@@ -315,12 +338,10 @@ void script::execute(sb_map* cur_map, const string& identifier, const uint3 posi
 				
 				// note: this will fail silently when there is no trigger at that position
 				// -> that way, more generic functions can be written, w/o taking care of any special cases (e.g. end of a loop)
-				const auto& triggers(cur_map->get_triggers());
-				for(const auto& trgr : triggers) {
-					if((trgr->position == pos).all()) {
-						trgr->activate(cur_map);
-						break;
-					}
+				// note: if there are multiple triggers at that position, the first one in map order is used
+				sb_map::trigger* trgr = cur_map->get_first_trigger(pos);
+				if(trgr != nullptr) {
+					trgr->activate(cur_map);
 				}
 			}
 			break;
@@ -377,7 +398,7 @@ void script::execute(sb_map* cur_map, const string& identifier, const uint3 posi
 			}
 			break;
 			case COMMAND::DELETE_TRIGGER: {
-				sb_map::trigger* trgr = cur_map->get_trigger(cmd[1]);
+				sb_map::trigger* trgr = cur_map->get_trigger(sym);
 				if(trgr == nullptr) {
 					script_error("there is no trigger with the name \""+cmd[1]+"\"");
 					break;
@@ -386,7 +407,7 @@ void script::execute(sb_map* cur_map, const string& identifier, const uint3 posi
 			}
 			break;
 			case COMMAND::MOVE_TRIGGER: {
-				sb_map::trigger* trgr = cur_map->get_trigger(cmd[1]);
+				sb_map::trigger* trgr = cur_map->get_trigger(sym);
 				if(trgr == nullptr) {
 					script_error("there is no trigger with the name \""+cmd[1]+"\"");
 					break;
@@ -396,7 +417,7 @@ void script::execute(sb_map* cur_map, const string& identifier, const uint3 posi
 					script_error("invalid position "+pos.to_string());
 					break;
 				}
-				trgr->position = pos;
+				cur_map->move_trigger(trgr, pos);
 			}
 			break;
 			case COMMAND::NOP:
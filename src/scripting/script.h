@@ -21,6 +21,7 @@
 #define __SB_SCRIPT_H__
 
 #include "sb_global.h"
+#include "symbol_table.h"
 
 class sb_map;
 class script {
@@ -30,13 +31,6 @@ public:
 	
 	void reload();
 	
-	struct script_function {
-		// note: lines are already tokenized
-		vector<vector<string>> lines;
-		script_function() : lines() {}
-		script_function(script_function&& sf) : lines(sf.lines) {}
-	};
-	
 	const string& get_filename() const;
 	
 	enum class COMMAND : unsigned int {
@@ -58,6 +52,16 @@ public:
 		MOVE_TRIGGER,
 	};
 	
+	struct script_function {
+		// note: lines are already tokenized
+		vector<vector<string>> lines;
+		// resolved on load: command and interned object identifier of each line (invalid_symbol if there is none)
+		vector<COMMAND> commands;
+		vector<symbol> symbols;
+		script_function() : lines(), commands(), symbols() {}
+		script_function(script_function&& sf) : lines(sf.lines), commands(sf.commands), symbols(sf.symbols) {}
+	};
+	
 	void execute(sb_map* cur_map, const string& identifier, const uint3 position = uint3(~0u)) const;
 	const unordered_map<string, script_function>& get_functions() const;
 	
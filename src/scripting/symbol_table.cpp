@@ -0,0 +1,45 @@
+/*
+ *  Blocks In Motion
+ *  Copyright (C) 2012 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "symbol_table.h"
+
+constexpr symbol symbol_table::invalid_symbol;
+mutex symbol_table::symbols_lock;
+unordered_map<string, symbol> symbol_table::symbols;
+
+symbol symbol_table::intern(const string& identifier) {
+	lock_guard<mutex> guard(symbols_lock);
+	const auto iter = symbols.find(identifier);
+	if(iter != symbols.end()) return iter->second;
+	
+	const symbol sym = (symbol)symbols.size();
+	symbols.insert(make_pair(identifier, sym));
+	return sym;
+}
+
+symbol symbol_table::lookup(const string& identifier) {
+	lock_guard<mutex> guard(symbols_lock);
+	const auto iter = symbols.find(identifier);
+	return (iter != symbols.end() ? iter->second : invalid_symbol);
+}
+
+size_t symbol_table::size() {
+	lock_guard<mutex> guard(symbols_lock);
+	return symbols.size();
+}
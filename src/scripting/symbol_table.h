@@ -0,0 +1,71 @@
+/*
+ *  Blocks In Motion
+ *  Copyright (C) 2012 Florian Ziesche
+ *  
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SB_SYMBOL_TABLE_H__
+#define __SB_SYMBOL_TABLE_H__
+
+#include "sb_global.h"
+
+// interned identifier: a dense id that can be used to directly index object containers
+typedef unsigned int symbol;
+
+// note: the table intentionally lives for the whole process and is never cleared: scripts are cached by the
+// script handler across map loads and store their resolved symbols, so symbols must stay valid (and unique)
+// as long as any script exists. since every identifier is only interned once, the table is bounded by the
+// number of distinct identifiers in all loaded maps and scripts (plus editor renames), which is small.
+class symbol_table {
+public:
+	static constexpr symbol invalid_symbol = ~0u;
+	
+	// returns the symbol of the identifier (adds it if it doesn't exist yet)
+	static symbol intern(const string& identifier);
+	// returns invalid_symbol if the identifier has never been interned
+	static symbol lookup(const string& identifier);
+	static size_t size();
+	
+protected:
+	static mutex symbols_lock;
+	static unordered_map<string, symbol> symbols;
+	
+};
+
+// symbol -> object lookup (the first inserted object wins if there are multiple objects with the same identifier)
+template <typename T> class symbol_index {
+public:
+	void insert(const symbol& sym, T* obj) {
+		if(sym == symbol_table::invalid_symbol) return;
+		if(sym >= objects.size()) objects.resize(sym + 1, nullptr);
+		if(objects[sym] == nullptr) objects[sym] = obj;
+	}
+	void erase(const symbol& sym, const T* obj) {
+		if(sym < objects.size() && objects[sym] == obj) objects[sym] = nullptr;
+	}
+	T* get(const symbol& sym) const {
+		return (sym < objects.size() ? objects[sym] : nullptr);
+	}
+	void clear() {
+		objects.clear();
+	}
+	
+protected:
+	vector<T*> objects;
+	
+};
+
+#endif
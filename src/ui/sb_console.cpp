@@ -524,6 +524,16 @@ void sb_console::execute_cmd(const string& cmd_str) {
 			
 			if(active_map != nullptr) {
 				add_line(u8"<b>#triggers</b>: " + size_t2string(active_map->get_triggers().size()), false);
+				
+				const array<size_t, 3> ai_lod_counts(active_map->get_ai_store().get_lod_counts());
+				add_line(u8"<b>#ais (full/reduced/minimal lod)</b>: " + size_t2string(active_map->get_ai_entities().size()) +
+						 " (" + size_t2string(ai_lod_counts[0]) + "/" + size_t2string(ai_lod_counts[1]) + "/" + size_t2string(ai_lod_counts[2]) + ")", false);
+			}
+			
+			if(ge != nullptr) {
+				const game::los_cache_stats los_stats(ge->get_los_cache_stats());
+				add_line(u8"<b>#los cache entries (hits/misses/evictions)</b>: " + size_t2string(los_stats.entries) +
+						 " (" + size_t2string(los_stats.hits) + "/" + size_t2string(los_stats.misses) + "/" + size_t2string(los_stats.evictions) + ")", false);
 			}
 		}
 		break;